@@ -0,0 +1,154 @@
+﻿#include "ReqAllocCounter.h"
+#include <atomic>
+
+#if defined(REQ_COUNT_ALLOCATIONS)
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<bool> g_counting(false);
+std::atomic<qint64> g_allocations(0);
+
+inline void countAllocation() {
+    if (g_counting.load(std::memory_order_relaxed)) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+#if defined(__GLIBC__)
+// glibc：在可执行文件中覆盖malloc族函数，Qt容器（直接调用malloc）与operator new的分配都能统计到
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) {
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    countAllocation();
+    return __libc_realloc(ptr, size);
+}
+}
+#else
+// 其余平台：替换全局operator new/delete（只统计C++对象分配，Qt容器内部的malloc不计）
+void *operator new(std::size_t size) {
+    countAllocation();
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    countAllocation();
+    return std::malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+#endif
+
+bool ReqAllocCounter::isAvailable() {
+    return true;
+}
+
+void ReqAllocCounter::start() {
+    g_allocations = 0;
+    g_counting = true;
+}
+
+qint64 ReqAllocCounter::stop() {
+    g_counting = false;
+    return g_allocations.load();
+}
+
+#elif defined(_MSC_VER) && defined(_DEBUG)
+#include <crtdbg.h>
+
+namespace {
+
+std::atomic<qint64> g_allocations(0);
+_CRT_ALLOC_HOOK g_previousHook = nullptr;
+
+// CRT分配钩子：只统计分配与重新分配，释放不计
+int countingHook(int allocType, void *userData, size_t size, int blockType, long requestNumber,
+                 const unsigned char *fileName, int lineNumber) {
+    if (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    return g_previousHook
+           ? g_previousHook(allocType, userData, size, blockType, requestNumber, fileName, lineNumber)
+           : TRUE;
+}
+
+} // namespace
+
+bool ReqAllocCounter::isAvailable() {
+    return true;
+}
+
+void ReqAllocCounter::start() {
+    g_allocations = 0;
+    g_previousHook = _CrtSetAllocHook(countingHook);
+}
+
+qint64 ReqAllocCounter::stop() {
+    _CrtSetAllocHook(g_previousHook);
+    g_previousHook = nullptr;
+    return g_allocations.load();
+}
+
+#else
+
+bool ReqAllocCounter::isAvailable() {
+    return false;
+}
+
+void ReqAllocCounter::start() {
+}
+
+qint64 ReqAllocCounter::stop() {
+    return -1;
+}
+
+#endif
@@ -0,0 +1,16 @@
+﻿#ifndef REQALLOCCOUNTER_H
+#define REQALLOCCOUNTER_H
+
+#include <QtGlobal>
+
+// 堆分配计数（基准测试用）：基准构建（qmake CONFIG+=bench，定义REQ_COUNT_ALLOCATIONS）替换全局分配函数统计，
+// 未开启时MSVC调试版退回CRT分配钩子，其余构建不可用
+// 计数包含所有线程的分配；同一时间只应有一个统计区间
+namespace ReqAllocCounter
+{
+    bool isAvailable();                                  // 当前构建是否支持计数
+    void start();                                        // 清零并开始计数
+    qint64 stop();                                       // 停止计数，返回区间内的分配次数（不可用时返回-1）
+}
+
+#endif // REQALLOCCOUNTER_H
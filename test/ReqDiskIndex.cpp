@@ -0,0 +1,756 @@
+﻿#include "ReqDiskIndex.h"
+#include "ReqTextSearch.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cstring>
+
+// 文本堆中的字符串（偏移与长度以UTF-16字符计）
+struct ReqIndexText {
+    quint64 offset;
+    quint32 length;
+    quint32 reserved;
+};
+
+// 定长需求记录；层次关系为记录序号（-1表示无）
+struct ReqIndexRecord {
+    ReqIndexText id;
+    ReqIndexText name;
+    ReqIndexText outline;
+    ReqIndexText description;
+    ReqIndexText richDescription;
+    ReqIndexText foldedName;                             // 折叠大小写后的名称（检索用）
+    ReqIndexText foldedDescription;                      // 折叠大小写后的描述（检索用）
+    qint32 sortNum;
+    qint32 level;
+    qint32 parent;
+    qint32 firstChild;
+    qint32 lastChild;
+    qint32 nextSibling;
+    quint32 flags;
+    quint32 reserved;
+};
+
+namespace {
+
+const char Magic[8] = { 'R', 'E', 'Q', 'I', 'D', 'X', '\0', '\1' };
+const quint32 Version = 2;
+const qint64 WindowBytes = 32 * 1024 * 1024;             // 映射窗口大小
+const int MaxWindows = 8;                                // 同时映射的窗口数（常驻上限约256MB）
+const qint64 CopyBytes = 1024 * 1024;                    // 记录文件拷贝到索引时的分块大小
+
+enum RecordFlag {
+    ValidFlag      = 0x1,                                // 有效需求
+    SupersededFlag = 0x2,                                // 被同ID的后续记录覆盖
+    RootFlag       = 0x4                                 // 已在顶层链表中
+};
+
+enum HeaderOption {
+    RichTextOption = 0x1                                 // 含富文本描述
+};
+
+struct ReqIndexHeader {
+    char magic[8];
+    quint32 version;
+    quint32 options;
+    qint64 sourceSize;                                   // 源文件大小与修改时间（毫秒），不一致时重建
+    qint64 sourceTime;
+    quint32 hierarchyRule;                               // 层次推断规则
+    quint32 reserved;
+    quint64 outlineKey;                                  // 章节号属性关键字的哈希（跨进程稳定）
+    qint64 heapOffset;
+    qint64 tablesOffset;                                 // 记录数组起点，其后紧接ID序号
+    qint32 recordCount;
+    qint32 reqCount;
+    qint32 validCount;
+    qint32 firstRoot;
+};
+
+static_assert(sizeof(ReqIndexRecord) % 8 == 0, "records must stay 8-byte aligned");
+static_assert(sizeof(ReqIndexHeader) % 8 == 0, "heap must start 8-byte aligned");
+
+// 章节号属性关键字的稳定哈希（qHash按进程随机加盐，不能写入文件）
+quint64 outlineKeyHash(const QString &key) {
+    const QByteArray sha1 = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1);
+    quint64 value;
+    memcpy(&value, sha1.constData(), sizeof(value));
+    return value;
+}
+
+// 同一索引路径的各版本文件（<名称>.reqidx与<名称>.<时间戳>.reqidx），按修改时间从新到旧
+QFileInfoList indexVersions(const QString &indexPath) {
+    const QFileInfo base(indexPath);
+    return base.absoluteDir().entryInfoList(QStringList() << base.completeBaseName() + "*.reqidx",
+                                            QDir::Files, QDir::Time);
+}
+
+} // namespace
+
+// 映射窗口：从缓存淘汰时解除映射
+struct ReqFileWindows::Window {
+    QFile *file = nullptr;
+    uchar *data = nullptr;
+    ~Window() {
+        if (data) file->unmap(data);
+    }
+};
+
+ReqFileWindows::ReqFileWindows(QFile *file, qint64 windowBytes, int maxWindows)
+    : m_file(file)
+    , m_windowBytes(windowBytes)
+{
+    m_cache.setMaxCost(maxWindows);
+}
+
+ReqFileWindows::~ReqFileWindows() {
+    clear();
+}
+
+void ReqFileWindows::setLimit(qint64 size) {
+    m_limit = size;
+}
+
+// 读取：区间位于单个窗口内时从映射拷贝，否则直接读文件
+bool ReqFileWindows::read(qint64 offset, void *out, qint64 size) const {
+    if (const uchar *data = pointer(offset, size)) {
+        memcpy(out, data, size_t(size));
+        return true;
+    }
+    return m_file->seek(offset) && m_file->read(static_cast<char *>(out), size) == size;
+}
+
+// 写入：映射为共享映射，写入窗口即写入文件；跨窗口时直接写文件并立即写出，避免映射读到旧内容
+bool ReqFileWindows::write(qint64 offset, const void *data, qint64 size) {
+    if (uchar *target = const_cast<uchar *>(pointer(offset, size))) {
+        memcpy(target, data, size_t(size));
+        return true;
+    }
+    return m_file->seek(offset) && m_file->write(static_cast<const char *>(data), size) == size && m_file->flush();
+}
+
+const uchar *ReqFileWindows::pointer(qint64 offset, qint64 size) const {
+    const qint64 index = offset / m_windowBytes;
+    if (offset < 0 || size <= 0 || offset + size > m_limit || offset + size > (index + 1) * m_windowBytes) {
+        return nullptr;
+    }
+    const uchar *data = window(index);
+    return data ? data + (offset - index * m_windowBytes) : nullptr;
+}
+
+void ReqFileWindows::clear() {
+    m_cache.clear();
+}
+
+qint64 ReqFileWindows::mappedBytes() const {
+    return qint64(m_cache.size()) * m_windowBytes;
+}
+
+// 取窗口映射（按需映射，超出窗口数时淘汰最久未用的窗口）
+uchar *ReqFileWindows::window(qint64 index) const {
+    if (Window *w = m_cache.object(index)) return w->data;
+    const qint64 begin = index * m_windowBytes;
+    const qint64 size = qMin(m_windowBytes, m_limit - begin);
+    if (size <= 0) return nullptr;
+    m_file->flush(); // 先写出缓冲区中的追加内容
+    uchar *data = m_file->map(begin, size);
+    if (!data) return nullptr;
+    Window *w = new Window;
+    w->file = m_file;
+    w->data = data;
+    m_cache.insert(index, w);
+    return data;
+}
+
+ReqDiskIndex::ReqDiskIndex()
+    : m_windows(&m_file, WindowBytes, MaxWindows)
+{
+}
+
+ReqDiskIndex::~ReqDiskIndex() {
+    close();
+}
+
+// 缓存目录下按源文件路径的SHA-1命名
+QString ReqDiskIndex::defaultPath(const QString &sourcePath) {
+    const QString canonical = QFileInfo(sourcePath).absoluteFilePath();
+    const QByteArray hash = QCryptographicHash::hash(canonical.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/index/" +
+           QString::fromLatin1(hash) + ".reqidx";
+}
+
+// 打开索引：从最新版本起逐个尝试，使用第一个与源文件、解析设置一致的版本
+bool ReqDiskIndex::open(const QString &indexPath, const QString &sourcePath, const ReqIndexOptions &options) {
+    close();
+    const QFileInfoList versions = indexVersions(indexPath);
+    if (versions.isEmpty()) {
+        m_errorString = u8"索引文件不存在";
+        return false;
+    }
+    foreach (const QFileInfo &version, versions) {
+        if (openVersion(version.absoluteFilePath(), sourcePath, options)) return true;
+    }
+    return false;
+}
+
+// 打开单个版本：校验格式、源文件版本与解析设置（记录数组与ID序号按需经窗口读取）
+bool ReqDiskIndex::openVersion(const QString &filePath, const QString &sourcePath, const ReqIndexOptions &options) {
+    close();
+    m_file.setFileName(filePath);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+
+    ReqIndexHeader header;
+    if (m_file.read(reinterpret_cast<char *>(&header), sizeof(header)) != qint64(sizeof(header)) ||
+        memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version) {
+        m_errorString = u8"索引文件格式不符";
+        close();
+        return false;
+    }
+    const QFileInfo source(sourcePath);
+    if (header.sourceSize != source.size() || header.sourceTime != source.lastModified().toMSecsSinceEpoch() ||
+        bool(header.options & RichTextOption) != options.richText || header.hierarchyRule != quint32(options.rule) ||
+        header.outlineKey != outlineKeyHash(options.outlineKey)) {
+        m_errorString = u8"索引与源文件不一致";
+        close();
+        return false;
+    }
+
+    m_recordCount = header.recordCount;
+    m_tablesOffset = header.tablesOffset;
+    const qint64 tablesSize = qint64(m_recordCount) * qint64(sizeof(ReqIndexRecord) + sizeof(qint32));
+    if (m_recordCount < 0 || m_tablesOffset + tablesSize > m_file.size()) {
+        m_errorString = u8"索引文件不完整";
+        close();
+        return false;
+    }
+    m_windows.setLimit(m_file.size());
+    m_heapOffset = header.heapOffset;
+    m_reqCount = header.reqCount;
+    m_validCount = header.validCount;
+    m_firstRoot = header.firstRoot;
+    return true;
+}
+
+void ReqDiskIndex::close() {
+    m_windows.clear(); // 先解除窗口映射
+    m_windows.setLimit(0);
+    m_file.close();
+    m_recordCount = 0;
+    m_reqCount = 0;
+    m_validCount = 0;
+    m_firstRoot = NoRecord;
+}
+
+bool ReqDiskIndex::isOpen() const {
+    return m_file.isOpen();
+}
+
+QString ReqDiskIndex::errorString() const {
+    return m_errorString;
+}
+
+int ReqDiskIndex::recordCount() const {
+    return m_recordCount;
+}
+
+int ReqDiskIndex::reqCount() const {
+    return m_reqCount;
+}
+
+int ReqDiskIndex::validCount() const {
+    return m_validCount;
+}
+
+qint64 ReqDiskIndex::mappedBytes() const {
+    return m_windows.mappedBytes();
+}
+
+// 按ID二分查找（序号按QString比较规则排列）
+int ReqDiskIndex::find(const QString &reqId) const {
+    int low = 0;
+    int high = m_recordCount - 1;
+    while (low <= high) {
+        const int mid = low + (high - low) / 2;
+        const int index = orderAt(mid);
+        if (index == NoRecord) break;
+        const int cmp = text(recordAt(index).id).compare(reqId);
+        if (cmp == 0) return index;
+        if (cmp < 0) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return NoRecord;
+}
+
+bool ReqDiskIndex::isLive(int index) const {
+    return !(recordAt(index).flags & SupersededFlag);
+}
+
+bool ReqDiskIndex::isValid(int index) const {
+    return recordAt(index).flags & ValidFlag;
+}
+
+// 需求字段（描述按需单独读取）
+ReqData ReqDiskIndex::record(int index) const {
+    const ReqIndexRecord r = recordAt(index);
+    ReqData req;
+    req.id = text(r.id);
+    req.name = text(r.name);
+    req.outlineNum = text(r.outline);
+    req.sortNum = r.sortNum;
+    req.level = r.level;
+    req.parentId = r.parent >= 0 ? text(recordAt(r.parent).id) : QString();
+    req.valid = r.flags & ValidFlag;
+    return req;
+}
+
+QString ReqDiskIndex::id(int index) const {
+    return text(recordAt(index).id);
+}
+
+QString ReqDiskIndex::description(int index) const {
+    return text(recordAt(index).description);
+}
+
+QString ReqDiskIndex::richDescription(int index) const {
+    return text(recordAt(index).richDescription);
+}
+
+int ReqDiskIndex::firstRoot() const {
+    return m_firstRoot;
+}
+
+int ReqDiskIndex::parent(int index) const {
+    return recordAt(index).parent;
+}
+
+int ReqDiskIndex::firstChild(int index) const {
+    return recordAt(index).firstChild;
+}
+
+int ReqDiskIndex::nextSibling(int index) const {
+    return recordAt(index).nextSibling;
+}
+
+// 顺序扫描折叠后的名称/描述，窗口逐个映射，结果按记录序号升序
+QVector<int> ReqDiskIndex::search(const QString &text, int fields) const {
+    QVector<int> hits;
+    const QString needle = text.toCaseFolded();
+    if (needle.isEmpty()) return hits;
+
+    QString spill;
+    for (int i = 0; i < m_recordCount; ++i) {
+        const ReqIndexRecord r = recordAt(i);
+        if (r.flags & SupersededFlag) continue;
+
+        bool hit = false;
+        if ((fields & ReqTextSearch::NameField) && r.foldedName.length > 0) {
+            const ushort *name = chars(r.foldedName, spill);
+            hit = reqFindFolded(name, int(r.foldedName.length), needle.utf16(), needle.size()) >= 0;
+        }
+        if (!hit && (fields & ReqTextSearch::DescriptionField) && r.foldedDescription.length > 0) {
+            const ushort *description = chars(r.foldedDescription, spill);
+            hit = reqFindFolded(description, int(r.foldedDescription.length), needle.utf16(), needle.size()) >= 0;
+        }
+        if (hit) hits.append(i);
+    }
+    return hits;
+}
+
+// 读取失败时按无层次关系的空记录处理
+ReqIndexRecord ReqDiskIndex::recordAt(int index) const {
+    Q_ASSERT(index >= 0 && index < m_recordCount);
+    ReqIndexRecord r;
+    if (!m_windows.read(m_tablesOffset + qint64(index) * qint64(sizeof(r)), &r, sizeof(r))) {
+        memset(&r, 0, sizeof(r));
+        r.parent = r.firstChild = r.lastChild = r.nextSibling = NoRecord;
+    }
+    return r;
+}
+
+int ReqDiskIndex::orderAt(int position) const {
+    Q_ASSERT(position >= 0 && position < m_recordCount);
+    qint32 index;
+    const qint64 offset = m_tablesOffset + qint64(m_recordCount) * qint64(sizeof(ReqIndexRecord)) +
+                          qint64(position) * qint64(sizeof(qint32));
+    if (!m_windows.read(offset, &index, sizeof(index)) || index < 0 || index >= m_recordCount) return NoRecord;
+    return index;
+}
+
+QString ReqDiskIndex::text(const ReqIndexText &ref) const {
+    if (ref.length == 0) return QString();
+    QString spill;
+    const ushort *data = chars(ref, spill);
+    return data == spill.utf16() ? spill : QString(reinterpret_cast<const QChar *>(data), int(ref.length));
+}
+
+// 文本指针：位于单个窗口内时直接指向映射，跨窗口（或映射失败）时读入spill
+// 返回的指针在下一次调用前有效
+const ushort *ReqDiskIndex::chars(const ReqIndexText &ref, QString &spill) const {
+    const qint64 begin = m_heapOffset + qint64(ref.offset) * qint64(sizeof(QChar));
+    const qint64 bytes = qint64(ref.length) * qint64(sizeof(QChar));
+    if (const uchar *data = m_windows.pointer(begin, bytes)) {
+        return reinterpret_cast<const ushort *>(data);
+    }
+
+    spill.resize(int(ref.length));
+    m_file.seek(begin);
+    m_file.read(reinterpret_cast<char *>(spill.data()), bytes);
+    return spill.utf16();
+}
+
+ReqDiskIndexBuilder::ReqDiskIndexBuilder()
+    : m_recordWindows(&m_records, WindowBytes, MaxWindows)
+    , m_outlines(ReqHierarchyInference::OutlineRule)
+    , m_sortNumbers(ReqHierarchyInference::SortNumberRule)
+{
+}
+
+ReqDiskIndexBuilder::~ReqDiskIndexBuilder() {
+    if (m_ok) abort();
+}
+
+// 开始构建：索引先写到.part文件，完成后改名为新的版本文件，中断时不会留下看似完整的索引
+bool ReqDiskIndexBuilder::begin(const QString &indexPath, const QString &sourcePath, const ReqIndexOptions &options) {
+    m_indexPath = indexPath;
+    const QFileInfo base(indexPath);
+    m_versionPath = base.absoluteDir().absoluteFilePath(
+        QString("%1.%2.reqidx").arg(base.completeBaseName()).arg(QDateTime::currentMSecsSinceEpoch()));
+    m_options = options;
+    const QFileInfo source(sourcePath);
+    m_sourceSize = source.size();
+    m_sourceTime = source.lastModified().toMSecsSinceEpoch();
+
+    if (!QDir().mkpath(QFileInfo(indexPath).absolutePath())) {
+        return fail(u8"无法创建索引目录：" + QFileInfo(indexPath).absolutePath());
+    }
+    m_out.setFileName(m_versionPath + ".part");
+    if (!m_out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return fail(u8"无法写入索引文件：" + m_out.errorString());
+    }
+    m_records.setFileName(m_versionPath + ".records");
+    if (!m_records.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        m_out.remove();
+        return fail(u8"无法写入索引文件：" + m_records.errorString());
+    }
+
+    // 文件头在完成时回填
+    const ReqIndexHeader header = ReqIndexHeader();
+    if (m_out.write(reinterpret_cast<const char *>(&header), sizeof(header)) != qint64(sizeof(header))) {
+        const QString error = m_out.errorString();
+        m_out.remove();
+        m_records.remove();
+        return fail(u8"无法写入索引文件：" + error);
+    }
+    m_ok = true;
+    return true;
+}
+
+// 写入一条需求：文本追加到文本堆，记录追加到记录文件
+void ReqDiskIndexBuilder::addReq(const ReqData &req) {
+    if (!m_ok) return;
+    m_recordWindows.clear(); // 层次之后仍出现需求对象时，先解除映射再追加（末尾窗口的映射范围随之变化）
+
+    ReqIndexRecord r;
+    memset(&r, 0, sizeof(r));
+    r.id.offset = writeText(req.id, &r.id.length);
+    r.name.offset = writeText(req.name, &r.name.length);
+    r.outline.offset = writeText(req.outlineNum, &r.outline.length);
+    r.description.offset = writeText(req.description, &r.description.length);
+    if (m_options.richText) {
+        r.richDescription.offset = writeText(req.richDescription, &r.richDescription.length);
+    }
+    r.foldedName.offset = writeText(req.name.toCaseFolded(), &r.foldedName.length);
+    r.foldedDescription.offset = writeText(req.description.toCaseFolded(), &r.foldedDescription.length);
+    r.sortNum = req.sortNum;
+    r.level = 1;
+    r.parent = r.firstChild = r.lastChild = r.nextSibling = -1;
+    r.flags = req.valid ? ValidFlag : 0;
+
+    const int index = m_recordCount++;
+    auto it = m_ids.find(req.id);
+    if (it != m_ids.end()) {
+        m_superseded.append(it.value());
+        it.value() = index;
+    } else {
+        m_ids.insert(req.id, index);
+    }
+
+    if (req.valid) {
+        if (!req.outlineNum.isEmpty() && m_outlines.addOutline(req.outlineNum)) {
+            m_outlineRecords.append(index);
+        }
+        if (req.sortNum > 0) {
+            m_sortNumbers.addSortNumber(req.sortNum);
+            m_sortRecords.append(index);
+        }
+    }
+
+    m_records.seek(qint64(index) * qint64(sizeof(r)));
+    if (m_records.write(reinterpret_cast<const char *>(&r), sizeof(r)) != qint64(sizeof(r))) {
+        fail(u8"写入索引失败：" + m_records.errorString());
+    }
+    m_recordWindows.setLimit(qint64(m_recordCount) * qint64(sizeof(r)));
+}
+
+// 层次关系：一个需求只挂载一次（多个规格引用时保留第一次），成环的关系忽略
+void ReqDiskIndexBuilder::addChild(const QString &parentId, const QString &childId) {
+    if (!m_ok) return;
+    const int child = m_ids.value(childId, -1);
+    if (child < 0) return;
+    ReqIndexRecord c = recordAt(child);
+    if (c.parent >= 0 || (c.flags & RootFlag)) return;
+
+    if (parentId.isEmpty()) {
+        c.flags |= RootFlag;
+        setRecord(child, c);
+        link(-1, child);
+        ++m_linkCount;
+        return;
+    }
+    const int parent = m_ids.value(parentId, -1);
+    if (parent < 0) return;
+    for (int p = parent; p >= 0 && m_ok; p = recordAt(p).parent) {
+        if (p == child) return;
+    }
+    link(parent, child);
+    ++m_linkCount;
+}
+
+bool ReqDiskIndexBuilder::contains(const QString &reqId) const {
+    return m_ids.contains(reqId);
+}
+
+// 完成构建
+bool ReqDiskIndexBuilder::finish() {
+    const ReqifParser::HierarchyRule rule = m_options.rule;
+    if (!m_ok) return false;
+
+    // 1. 标记被同ID覆盖的记录
+    foreach (int index, m_superseded) {
+        ReqIndexRecord r = recordAt(index);
+        r.flags |= SupersededFlag;
+        setRecord(index, r);
+    }
+
+    // 2. 无显式层次时按规则推断（与内存模式相同的章节号/排序号规则）
+    if (m_linkCount == 0 && rule != ReqifParser::InferNone) {
+        const bool useOutline = rule == ReqifParser::InferFromOutline ||
+                                (rule == ReqifParser::InferAuto && !m_outlineRecords.isEmpty());
+        const ReqHierarchyInference &inference = useOutline ? m_outlines : m_sortNumbers;
+        const QVector<int> &records = useOutline ? m_outlineRecords : m_sortRecords;
+        QVector<int> levels;
+        const QVector<int> parents = inference.inferParents(&levels);
+        for (int i = 0; i < records.size(); ++i) {
+            ReqIndexRecord r = recordAt(records.at(i));
+            r.level = levels.at(i);
+            setRecord(records.at(i), r);
+            if (parents.at(i) >= 0) {
+                link(records.at(parents.at(i)), records.at(i));
+            }
+        }
+    }
+
+    // 3. 未挂载的有效需求按文档顺序追加为顶层；显式层次时沿父链计算层级
+    int validCount = 0;
+    for (int i = 0; i < m_recordCount; ++i) {
+        ReqIndexRecord r = recordAt(i);
+        if (r.flags & SupersededFlag) continue;
+        if (r.flags & ValidFlag) ++validCount;
+        if (r.parent < 0 && !(r.flags & RootFlag) && (r.flags & ValidFlag)) {
+            r.flags |= RootFlag;
+            setRecord(i, r);
+            link(-1, i);
+            r = recordAt(i);
+        }
+        if (m_linkCount > 0) {
+            int level = 1;
+            for (int p = r.parent; p >= 0 && level <= m_recordCount; p = recordAt(p).parent) ++level;
+            if (r.level != level) {
+                r.level = level;
+                setRecord(i, r);
+            }
+        }
+    }
+    if (!m_ok) return false;
+
+    // 4. 记录数组（8字节对齐）与按ID排序的序号
+    const qint64 heapEnd = qint64(sizeof(ReqIndexHeader)) + qint64(m_heapChars) * qint64(sizeof(QChar));
+    const qint64 tablesOffset = (heapEnd + 7) & ~qint64(7);
+    const QByteArray padding(int(tablesOffset - heapEnd), '\0');
+    if (m_out.write(padding) != padding.size()) {
+        return fail(u8"写入索引失败：" + m_out.errorString());
+    }
+    const qint64 recordBytes = qint64(m_recordCount) * qint64(sizeof(ReqIndexRecord));
+    m_recordWindows.clear(); // 共享映射中的修改已在文件中，解除映射后分块拷贝
+    if (!m_records.seek(0)) {
+        return fail(u8"读取索引记录失败：" + m_records.errorString());
+    }
+    for (qint64 copied = 0; copied < recordBytes;) {
+        const QByteArray chunk = m_records.read(qMin(CopyBytes, recordBytes - copied));
+        if (chunk.isEmpty()) {
+            return fail(u8"读取索引记录失败：" + m_records.errorString());
+        }
+        if (m_out.write(chunk) != chunk.size()) {
+            return fail(u8"写入索引失败：" + m_out.errorString());
+        }
+        copied += chunk.size();
+    }
+
+    QVector<QPair<QString, int>> ids;
+    ids.reserve(m_ids.size());
+    for (auto it = m_ids.constBegin(); it != m_ids.constEnd(); ++it) {
+        ids.append(qMakePair(it.key(), it.value()));
+    }
+    std::sort(ids.begin(), ids.end());
+    QVector<qint32> order;
+    order.reserve(m_recordCount);
+    for (const auto &id : ids) {
+        order.append(id.second);
+    }
+    ids.clear();
+    m_ids.clear();
+    // 被覆盖的记录不参与查找，序号表按记录数补齐，保持定长布局
+    while (order.size() < m_recordCount) {
+        order.append(order.isEmpty() ? 0 : order.last());
+    }
+    const qint64 orderBytes = qint64(order.size()) * qint64(sizeof(qint32));
+    if (m_out.write(reinterpret_cast<const char *>(order.constData()), orderBytes) != orderBytes) {
+        return fail(u8"写入索引失败：" + m_out.errorString());
+    }
+
+    // 5. 回填文件头后改名
+    ReqIndexHeader header = ReqIndexHeader();
+    memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.options = m_options.richText ? RichTextOption : 0;
+    header.sourceSize = m_sourceSize;
+    header.sourceTime = m_sourceTime;
+    header.hierarchyRule = quint32(m_options.rule);
+    header.outlineKey = outlineKeyHash(m_options.outlineKey);
+    header.heapOffset = sizeof(ReqIndexHeader);
+    header.tablesOffset = tablesOffset;
+    header.recordCount = m_recordCount;
+    header.reqCount = m_recordCount - m_superseded.size();
+    header.validCount = validCount;
+    header.firstRoot = m_firstRoot;
+    if (!m_out.seek(0) ||
+        m_out.write(reinterpret_cast<const char *>(&header), sizeof(header)) != qint64(sizeof(header)) ||
+        !m_out.flush()) {
+        return fail(u8"写入索引失败：" + m_out.errorString());
+    }
+    m_out.close();
+    m_records.remove();
+
+    if (!QFile::rename(m_out.fileName(), m_versionPath)) {
+        QFile::remove(m_out.fileName());
+        m_ok = false;
+        m_errorString = u8"无法写入索引文件：" + m_versionPath;
+        return false;
+    }
+    m_ok = false;
+
+    // 清理旧版本：其他文档仍在映射的版本在Windows上删除失败，留待下次重建时清理
+    foreach (const QFileInfo &version, indexVersions(m_indexPath)) {
+        if (version.absoluteFilePath() != m_versionPath) {
+            QFile::remove(version.absoluteFilePath());
+        }
+    }
+    return true;
+}
+
+// 放弃构建，删除临时文件
+void ReqDiskIndexBuilder::abort() {
+    m_recordWindows.clear();
+    m_out.remove();
+    m_records.remove();
+    m_ok = false;
+}
+
+QString ReqDiskIndexBuilder::errorString() const {
+    return m_errorString;
+}
+
+// 读取失败时构建失败，返回无层次关系的空记录
+ReqIndexRecord ReqDiskIndexBuilder::recordAt(int index) {
+    Q_ASSERT(index >= 0 && index < m_recordCount);
+    ReqIndexRecord r;
+    if (!m_recordWindows.read(qint64(index) * qint64(sizeof(r)), &r, sizeof(r))) {
+        memset(&r, 0, sizeof(r));
+        r.parent = r.firstChild = r.lastChild = r.nextSibling = -1;
+        fail(u8"读取索引记录失败：" + m_records.errorString());
+    }
+    return r;
+}
+
+void ReqDiskIndexBuilder::setRecord(int index, const ReqIndexRecord &record) {
+    Q_ASSERT(index >= 0 && index < m_recordCount);
+    if (!m_recordWindows.write(qint64(index) * qint64(sizeof(record)), &record, sizeof(record))) {
+        fail(u8"写入索引失败：" + m_records.errorString());
+    }
+}
+
+// 追加到子链表末尾
+void ReqDiskIndexBuilder::link(int parent, int child) {
+    ReqIndexRecord c = recordAt(child);
+    c.parent = parent;
+    setRecord(child, c);
+
+    int first = m_firstRoot;
+    int last = m_lastRoot;
+    if (parent >= 0) {
+        const ReqIndexRecord p = recordAt(parent);
+        first = p.firstChild;
+        last = p.lastChild;
+    }
+    if (first < 0) {
+        first = child;
+    } else {
+        ReqIndexRecord l = recordAt(last);
+        l.nextSibling = child;
+        setRecord(last, l);
+    }
+    last = child;
+
+    if (parent >= 0) {
+        ReqIndexRecord p = recordAt(parent);
+        p.firstChild = first;
+        p.lastChild = last;
+        setRecord(parent, p);
+    } else {
+        m_firstRoot = first;
+        m_lastRoot = last;
+    }
+}
+
+// 写入文本堆（UTF-16原样写出，读取时可直接映射使用）
+quint64 ReqDiskIndexBuilder::writeText(const QString &text, quint32 *length) {
+    const quint64 offset = m_heapChars;
+    *length = quint32(text.size());
+    if (text.isEmpty()) return offset;
+
+    const qint64 bytes = qint64(text.size()) * qint64(sizeof(QChar));
+    if (m_out.write(reinterpret_cast<const char *>(text.constData()), bytes) != bytes) {
+        fail(u8"写入索引失败：" + m_out.errorString());
+        return offset;
+    }
+    m_heapChars += quint64(text.size());
+    return offset;
+}
+
+bool ReqDiskIndexBuilder::fail(const QString &message) {
+    if (m_ok) {
+        m_errorString = message;
+    } else if (m_errorString.isEmpty()) {
+        m_errorString = message;
+    }
+    m_ok = false;
+    return false;
+}
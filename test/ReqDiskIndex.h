@@ -0,0 +1,154 @@
+﻿#ifndef REQDISKINDEX_H
+#define REQDISKINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QFile>
+#include <QCache>
+#include "ReqifParser.h"
+#include "ReqHierarchyInference.h"
+
+struct ReqIndexText;
+struct ReqIndexRecord;
+
+// 影响索引内容的解析设置：记录在索引头中，任一项与当前设置不一致时重建
+struct ReqIndexOptions {
+    bool richText = false;                               // 含富文本描述
+    ReqifParser::HierarchyRule rule = ReqifParser::InferAuto; // 层次推断规则
+    QString outlineKey;                                  // 章节号属性定义引用关键字
+};
+
+// 文件映射窗口：按固定大小对齐映射，只保留最近使用的若干窗口（LRU），淘汰时解除映射
+// 映射的地址空间不超过 窗口大小×窗口数，与文件大小无关；跨窗口的区间直接读写文件
+class ReqFileWindows
+{
+public:
+    ReqFileWindows(QFile *file, qint64 windowBytes, int maxWindows);
+    ~ReqFileWindows();
+
+    void setLimit(qint64 size);                          // 可映射的文件范围（追加写入前须先clear()）
+    bool read(qint64 offset, void *out, qint64 size) const;
+    bool write(qint64 offset, const void *data, qint64 size); // 文件须以读写方式打开
+    const uchar *pointer(qint64 offset, qint64 size) const; // 区间位于单个窗口内时返回映射指针（下一次访问前有效），否则为空
+    void clear();                                        // 解除全部映射
+    qint64 mappedBytes() const;
+
+private:
+    struct Window;
+    uchar *window(qint64 index) const;
+
+private:
+    QFile *m_file;
+    qint64 m_windowBytes;
+    qint64 m_limit = 0;
+    mutable QCache<qint64, Window> m_cache;
+};
+
+// 超大文件模式的磁盘需求索引：定长记录 + UTF-16文本堆
+// 文件布局：文件头 | 文本堆 | 记录数组 | 按ID排序的记录序号
+// 文本堆、记录数组与序号共用一组映射窗口，常驻内存与地址空间占用与源文件大小无关
+class ReqDiskIndex
+{
+public:
+    enum { NoRecord = -1 };
+
+    ReqDiskIndex();
+    ~ReqDiskIndex();
+
+    static QString defaultPath(const QString &sourcePath); // 缓存目录下按源文件路径命名的索引文件
+    // 打开indexPath的最新可用版本（校验与源文件、解析设置一致）
+    bool open(const QString &indexPath, const QString &sourcePath, const ReqIndexOptions &options);
+    void close();
+    bool isOpen() const;
+    QString errorString() const;
+
+    int recordCount() const;                             // 记录数（含被同ID覆盖的记录）
+    int reqCount() const;                                // 需求数
+    int validCount() const;                              // 有效需求数
+    qint64 mappedBytes() const;                          // 当前映射的字节数（记录数组与文本堆窗口）
+
+    int find(const QString &reqId) const;                // 按ID二分查找记录（未找到返回NoRecord）
+    bool isLive(int index) const;                        // 记录未被同ID覆盖
+    bool isValid(int index) const;                       // 有效需求
+    ReqData record(int index) const;                     // 需求字段（不含描述）
+    QString id(int index) const;
+    QString description(int index) const;
+    QString richDescription(int index) const;
+
+    int firstRoot() const;                               // 顶层需求链表
+    int parent(int index) const;
+    int firstChild(int index) const;
+    int nextSibling(int index) const;
+
+    QVector<int> search(const QString &text, int fields) const; // 不区分大小写检索（fields同ReqTextSearch::Field）
+
+private:
+    bool openVersion(const QString &filePath, const QString &sourcePath, const ReqIndexOptions &options); // 打开单个版本文件
+    ReqIndexRecord recordAt(int index) const;            // 读取记录（经窗口缓存）
+    int orderAt(int position) const;                     // 按ID排序的第position个记录序号
+    QString text(const ReqIndexText &ref) const;         // 读取文本（经窗口缓存）
+    const ushort *chars(const ReqIndexText &ref, QString &spill) const; // 文本指针（跨窗口时读入spill）
+
+private:
+    mutable QFile m_file;
+    qint64 m_tablesOffset = 0;                           // 记录数组起点，其后紧接按ID排序的记录序号
+    qint64 m_heapOffset = 0;
+    int m_recordCount = 0;
+    int m_reqCount = 0;
+    int m_validCount = 0;
+    int m_firstRoot = NoRecord;
+    ReqFileWindows m_windows;                            // 映射窗口（文本堆、记录与序号共用）
+    QString m_errorString;
+};
+
+// 索引构建：流式解析时逐条写入记录与文本，层次关系经映射窗口在记录文件上就地链接
+// 构建期间内存中保留ID -> 记录序号（随需求数线性增长，约每百万需求150MB）与层次推断所需的整数
+// 每次构建写出新的版本文件，不覆盖其他文档仍在映射的旧版本（Windows上映射中的文件不能删除或替换）
+class ReqDiskIndexBuilder
+{
+public:
+    ReqDiskIndexBuilder();
+    ~ReqDiskIndexBuilder();
+
+    bool begin(const QString &indexPath, const QString &sourcePath, const ReqIndexOptions &options);
+    void addReq(const ReqData &req);                     // 写入一条需求（同ID后出现的覆盖先出现的）
+    void addChild(const QString &parentId, const QString &childId); // 层次关系（parentId为空时为顶层）
+    bool contains(const QString &reqId) const;           // 是否已写入该ID的需求
+    bool finish();                                       // 补充推断层次、层级与顶层，写出记录与序号
+    void abort();                                        // 放弃并删除未完成的文件
+    QString errorString() const;
+
+private:
+    ReqIndexRecord recordAt(int index);                  // 读取记录（经窗口缓存）
+    void setRecord(int index, const ReqIndexRecord &record); // 写回记录
+    void link(int parent, int child);                    // 追加到父记录（parent为NoRecord时为顶层）的子链表末尾
+    quint64 writeText(const QString &text, quint32 *length); // 写入文本堆，返回偏移（字符）
+    bool fail(const QString &message);
+
+private:
+    QString m_indexPath;                                 // 索引路径（各版本的共同前缀）
+    QString m_versionPath;                               // 本次构建的版本文件
+    QFile m_out;                                         // 索引文件（写入中）
+    QFile m_records;                                     // 记录临时文件
+    ReqFileWindows m_recordWindows;                      // 记录文件的映射窗口（层次链接时按需映射）
+    qint64 m_sourceSize = 0;
+    qint64 m_sourceTime = 0;
+    ReqIndexOptions m_options;
+    quint64 m_heapChars = 0;
+    int m_recordCount = 0;
+    int m_linkCount = 0;
+    int m_firstRoot = -1;
+    int m_lastRoot = -1;
+    QHash<QString, int> m_ids;                           // ID -> 记录序号（后出现的覆盖）
+    QVector<int> m_superseded;                           // 被同ID覆盖的记录
+    ReqHierarchyInference m_outlines;                    // 章节号推断（有效需求）
+    QVector<int> m_outlineRecords;
+    ReqHierarchyInference m_sortNumbers;                 // 排序号推断（有效需求）
+    QVector<int> m_sortRecords;
+    bool m_ok = false;
+    QString m_errorString;
+};
+
+#endif // REQDISKINDEX_H
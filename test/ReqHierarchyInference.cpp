@@ -0,0 +1,123 @@
+﻿#include "ReqHierarchyInference.h"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+// 排序号位数即层级
+inline int digitCount(int value) {
+    int digits = 1;
+    while (value >= 10) {
+        value /= 10;
+        ++digits;
+    }
+    return digits;
+}
+
+} // namespace
+
+ReqHierarchyInference::ReqHierarchyInference(Rule rule)
+    : m_rule(rule)
+{
+    m_offsets.append(0);
+}
+
+void ReqHierarchyInference::reserve(int count) {
+    if (m_rule == OutlineRule) {
+        m_components.reserve(count * 3);
+        m_offsets.reserve(count + 1);
+    } else {
+        m_sortNums.reserve(count);
+    }
+}
+
+// 解析章节号：以'.'分隔的非负整数，允许首尾空白和末尾的'.'
+bool ReqHierarchyInference::addOutline(const QString &outline) {
+    const int start = m_components.size();
+    const QChar *p = outline.constData();
+    const QChar *end = p + outline.size();
+    while (p != end && p->isSpace()) ++p;
+    while (end != p && (end - 1)->isSpace()) --end;
+    if (end != p && *(end - 1) == QLatin1Char('.')) --end;
+
+    while (p != end) {
+        int value = 0;
+        const QChar *digits = p;
+        while (p != end && p->unicode() >= '0' && p->unicode() <= '9' && value < 100000000) {
+            value = value * 10 + (p->unicode() - '0');
+            ++p;
+        }
+        if (p == digits || (p != end && *p != QLatin1Char('.'))) {
+            m_components.resize(start); // 含非数字分段，放弃该条目
+            return false;
+        }
+        m_components.append(value);
+        if (p != end) ++p; // 跳过'.'
+    }
+    if (m_components.size() == start) return false;
+    m_offsets.append(m_components.size());
+    return true;
+}
+
+void ReqHierarchyInference::addSortNumber(int sortNum) {
+    m_sortNums.append(sortNum);
+}
+
+int ReqHierarchyInference::size() const {
+    return m_rule == OutlineRule ? m_offsets.size() - 1 : m_sortNums.size();
+}
+
+// 排序后单次扫描：栈中为当前条目的祖先链，不是祖先的条目出栈，栈顶即父条目
+// 章节号的层级为祖先链长度（缺失的中间级不计）；排序号的层级为位数，与父条目是否存在无关
+QVector<int> ReqHierarchyInference::inferParents(QVector<int> *levels) const {
+    const int count = size();
+    QVector<int> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    if (m_rule == OutlineRule) {
+        std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return outlineLess(a, b); });
+    } else {
+        std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return m_sortNums.at(a) < m_sortNums.at(b); });
+    }
+
+    QVector<int> parents(count, -1);
+    if (levels) levels->fill(1, count);
+    QVector<int> stack;
+    QVector<int> depths; // 排序号规则：栈中条目的位数
+    for (int entry : order) {
+        int level = 0;
+        if (m_rule == OutlineRule) {
+            while (!stack.isEmpty() && !isPrefix(stack.last(), entry)) stack.removeLast();
+            level = stack.size() + 1;
+        } else {
+            level = digitCount(qMax(0, m_sortNums.at(entry)));
+            while (!depths.isEmpty() && depths.last() >= level) {
+                stack.removeLast();
+                depths.removeLast();
+            }
+            depths.append(level);
+        }
+        if (!stack.isEmpty()) parents[entry] = stack.last();
+        if (levels) (*levels)[entry] = level;
+        stack.append(entry);
+    }
+    return parents;
+}
+
+// 章节号parent是否为child的真前缀（"3.2"是"3.2.1"的前缀，缺失的中间级跳过）
+bool ReqHierarchyInference::isPrefix(int parent, int child) const {
+    const int parentLength = m_offsets.at(parent + 1) - m_offsets.at(parent);
+    const int childLength = m_offsets.at(child + 1) - m_offsets.at(child);
+    if (parentLength >= childLength) return false;
+    const int *a = m_components.constData() + m_offsets.at(parent);
+    const int *b = m_components.constData() + m_offsets.at(child);
+    return std::equal(a, a + parentLength, b);
+}
+
+// 章节号逐段比较（"3.10"排在"3.9"之后，前缀排在前面）
+bool ReqHierarchyInference::outlineLess(int a, int b) const {
+    const int *first1 = m_components.constData() + m_offsets.at(a);
+    const int *last1 = m_components.constData() + m_offsets.at(a + 1);
+    const int *first2 = m_components.constData() + m_offsets.at(b);
+    const int *last2 = m_components.constData() + m_offsets.at(b + 1);
+    return std::lexicographical_compare(first1, last1, first2, last2);
+}
@@ -0,0 +1,36 @@
+﻿#ifndef REQHIERARCHYINFERENCE_H
+#define REQHIERARCHYINFERENCE_H
+
+#include <QString>
+#include <QVector>
+
+// 层次推断：按章节号或排序号排序后用栈单次扫描确定父条目，层级深度不限
+// 条目按加入顺序编号，键值连续存放，百万级条目不逐条分配内存
+class ReqHierarchyInference
+{
+public:
+    enum Rule {
+        OutlineRule,             // 章节号（"3.2.1.4"）：父条目为最近的前缀章节号
+        SortNumberRule           // 排序号：位数即层级（1位第1级，2位第2级……），父条目为之前最近的更浅条目
+    };
+
+    explicit ReqHierarchyInference(Rule rule);
+
+    void reserve(int count);                             // 预分配条目数
+    bool addOutline(const QString &outline);             // 加入章节号条目（无法解析时返回false且不加入）
+    void addSortNumber(int sortNum);                     // 加入排序号条目
+    int size() const;                                    // 条目数
+    QVector<int> inferParents(QVector<int> *levels = nullptr) const; // 各条目的父条目下标（-1为顶层）及层级
+
+private:
+    bool isPrefix(int parent, int child) const;          // 章节号parent是否为child的真前缀
+    bool outlineLess(int a, int b) const;                // 章节号逐段比较
+
+private:
+    Rule m_rule;
+    QVector<int> m_components;                           // 全部章节号分段（连续存放）
+    QVector<int> m_offsets;                              // 各条目分段起点（末尾附总长度）
+    QVector<int> m_sortNums;                             // 各条目排序号（排序号规则）
+};
+
+#endif // REQHIERARCHYINFERENCE_H
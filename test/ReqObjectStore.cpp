@@ -0,0 +1,282 @@
+﻿#include "ReqObjectStore.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMimeDatabase>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+#include <cstring>
+
+namespace {
+
+const int ChunkSize = 64 * 1024;                         // 流式处理块大小
+
+inline bool isBase64Char(char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+           c == '+' || c == '/' || c == '=';
+}
+
+// 写出并累计哈希
+bool writeChunk(QIODevice *out, QCryptographicHash &hash, const QByteArray &data) {
+    hash.addData(data);
+    return out->write(data) == data.size();
+}
+
+} // namespace
+
+ReqObjectStore::ReqObjectStore()
+    : m_cacheDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/objects")
+    , m_mutex(QMutex::Recursive)
+{
+}
+
+// 切换源文件并清空索引
+void ReqObjectStore::reset(const QString &sourcePath) {
+    QMutexLocker locker(&m_mutex);
+    m_sourcePath = sourcePath;
+    m_objects.clear();
+    m_count = 0;
+    m_raw.clear();
+    m_specObjectRanges.clear();
+    m_extracted.clear();
+    m_errorString.clear();
+    ++m_generation;
+}
+
+// 接管另一存储的对象索引（源文件内容已变化，字节区间与提取记录一并作废）
+void ReqObjectStore::takeIndex(ReqObjectStore &other) {
+    QMutexLocker locker(&m_mutex);
+    QMutexLocker otherLocker(&other.m_mutex);
+    reset(other.m_sourcePath);
+    m_objects.swap(other.m_objects);
+    m_count = other.m_count;
+    other.reset(other.m_sourcePath);
+}
+
+void ReqObjectStore::add(const ReqEmbeddedObject &object) {
+    QMutexLocker locker(&m_mutex);
+    m_objects[object.reqId].append(object);
+    ++m_count;
+}
+
+QList<ReqEmbeddedObject> ReqObjectStore::objects(const QString &reqId) const {
+    QMutexLocker locker(&m_mutex);
+    return m_objects.value(reqId);
+}
+
+int ReqObjectStore::count() const {
+    QMutexLocker locker(&m_mutex);
+    return m_count;
+}
+
+void ReqObjectStore::setCacheDir(const QString &dir) {
+    QMutexLocker locker(&m_mutex);
+    m_cacheDir = dir;
+    m_extracted.clear();
+}
+
+QString ReqObjectStore::cacheDir() const {
+    QMutexLocker locker(&m_mutex);
+    return m_cacheDir;
+}
+
+QString ReqObjectStore::errorString() const {
+    QMutexLocker locker(&m_mutex);
+    return m_errorString;
+}
+
+void ReqObjectStore::setError(const QString &error) {
+    QMutexLocker locker(&m_mutex);
+    m_errorString = error;
+}
+
+// 提取到缓存：边解码边计算SHA-1，写入临时文件后按哈希命名
+// 持锁只做缓存命中判断、字节区间定位与结果登记，解码期间不阻塞其他线程
+QString ReqObjectStore::extract(const ReqEmbeddedObject &object) {
+    const QString key = object.reqId + '#' + QString::number(object.ordinal);
+    QString cacheDir;
+    QString externalPath;
+    QSharedPointer<ReqifRawFile> raw;
+    ReqifByteRange base64;
+    int generation = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        const QString cached = m_extracted.value(key);
+        if (!cached.isEmpty() && QFileInfo::exists(cached)) return cached;
+
+        cacheDir = m_cacheDir;
+        generation = m_generation;
+        if (!object.dataRef.isEmpty()) {
+            // 外部文件（reqifz解压目录中的附件等），相对源文件所在目录
+            externalPath = resolveExternal(object.dataRef);
+            if (externalPath.isEmpty()) return QString();
+        } else {
+            if (!locateInlineData(object, base64)) return QString();
+            raw = m_raw;
+        }
+    }
+
+    if (!QDir().mkpath(cacheDir)) {
+        setError(u8"无法创建缓存目录：" + cacheDir);
+        return QString();
+    }
+
+    QTemporaryFile tmp(cacheDir + "/XXXXXX.part");
+    if (!tmp.open()) {
+        setError(u8"无法创建缓存文件：" + tmp.errorString());
+        return QString();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    QString error;
+    const bool ok = raw ? decodeBase64(raw->data(), base64, &tmp, hash, error)
+                        : copyFile(externalPath, &tmp, hash, error);
+    if (!ok) {
+        setError(error);
+        return QString();
+    }
+
+    const QString finalPath = QString("%1/%2.%3").arg(cacheDir)
+                              .arg(QString::fromLatin1(hash.result().toHex()))
+                              .arg(suffixFor(object));
+    if (!QFileInfo::exists(finalPath)) {
+        // 其他线程可能同时写出了相同内容，重命名失败但目标已存在时视为成功
+        if (tmp.rename(finalPath)) {
+            tmp.setAutoRemove(false);
+        } else if (!QFileInfo::exists(finalPath)) {
+            setError(u8"无法写入缓存文件：" + tmp.errorString());
+            return QString();
+        }
+    }
+    // 已存在相同内容的文件时临时文件自动删除
+
+    QMutexLocker locker(&m_mutex);
+    if (generation == m_generation && cacheDir == m_cacheDir) {
+        m_extracted.insert(key, finalPath);
+    }
+    return finalPath;
+}
+
+// 解析外部文件引用：data属性来自源文件，不可信；规范化（含符号链接）后必须位于源文件所在目录内，
+// 绝对路径与"../"越出目录的引用一律拒绝，避免把任意本地文件复制进缓存并作为附件链接打开（持锁调用）
+QString ReqObjectStore::resolveExternal(const QString &dataRef) {
+    const QDir baseDir = QFileInfo(m_sourcePath).absoluteDir();
+    const QString base = baseDir.canonicalPath();
+    const QString path = QFileInfo(baseDir.absoluteFilePath(dataRef)).canonicalFilePath();
+    if (base.isEmpty() || path.isEmpty()) {
+        m_errorString = u8"无法读取附件：" + dataRef;
+        return QString();
+    }
+    const QString relative = QDir(base).relativeFilePath(path);
+    if (QDir::isAbsolutePath(dataRef) || QDir::isAbsolutePath(relative) ||
+        relative == QLatin1String("..") || relative.startsWith(QLatin1String("../"))) {
+        m_errorString = u8"附件路径超出源文件所在目录，已拒绝：" + dataRef;
+        return QString();
+    }
+    return path;
+}
+
+// 定位内联base64字节区间：找到所属SPEC-OBJECT中第ordinal个object元素的data属性
+bool ReqObjectStore::locateInlineData(const ReqEmbeddedObject &object, ReqifByteRange &base64) {
+    if (!m_raw) {
+        QSharedPointer<ReqifRawFile> raw(new ReqifRawFile);
+        if (!raw->openUtf8(m_sourcePath)) { // 宽字符编码转为UTF-8副本后定位
+            m_errorString = u8"无法读取源文件：" + raw->errorString();
+            return false;
+        }
+        m_specObjectRanges = raw->indexElements("SPEC-OBJECT", raw->whole());
+        m_raw = raw;
+    }
+
+    ReqifByteRange rest = m_specObjectRanges.value(object.reqId);
+    ReqifByteRange element;
+    for (int i = 0; i <= object.ordinal; ++i) {
+        element = m_raw->findElement("object", rest);
+        if (!element.isValid()) {
+            m_errorString = u8"源文件已变化，未找到嵌入对象";
+            return false;
+        }
+        rest.begin = element.begin + 1; // 嵌套对象同样计数
+    }
+
+    const ReqifByteRange data = m_raw->attributeRange(element, "data");
+    if (!data.isValid()) {
+        m_errorString = u8"嵌入对象缺少data属性";
+        return false;
+    }
+    const char *begin = m_raw->data() + data.begin;
+    const char *comma = static_cast<const char *>(memchr(begin, ',', size_t(data.size())));
+    if (!comma || !QByteArray::fromRawData(begin, int(comma - begin)).endsWith(";base64")) {
+        m_errorString = u8"不支持的嵌入数据格式";
+        return false;
+    }
+    base64.begin = comma - m_raw->data() + 1;
+    base64.end = data.end;
+    return true;
+}
+
+// 流式解码：按块收集有效字符，每次只解码4的整数倍，余数留到下一块
+bool ReqObjectStore::decodeBase64(const char *data, const ReqifByteRange &range, QIODevice *out,
+                                  QCryptographicHash &hash, QString &error) {
+    QByteArray pending;
+    pending.reserve(ChunkSize + 4);
+
+    for (qint64 i = range.begin; i < range.end; ++i) {
+        const char c = data[i];
+        if (c == '&') {
+            // 跳过字符实体（如换行&#10;）
+            const char *semi = static_cast<const char *>(memchr(data + i, ';', size_t(range.end - i)));
+            if (!semi) break;
+            i = semi - data;
+            continue;
+        }
+        if (!isBase64Char(c)) continue;
+
+        pending += c;
+        if (pending.size() >= ChunkSize) {
+            const int whole = pending.size() & ~3;
+            if (!writeChunk(out, hash, QByteArray::fromBase64(pending.left(whole)))) {
+                error = u8"写入缓存文件失败：" + out->errorString();
+                return false;
+            }
+            pending.remove(0, whole);
+        }
+    }
+    if (!pending.isEmpty() && !writeChunk(out, hash, QByteArray::fromBase64(pending))) {
+        error = u8"写入缓存文件失败：" + out->errorString();
+        return false;
+    }
+    return true;
+}
+
+// 流式拷贝外部文件
+bool ReqObjectStore::copyFile(const QString &path, QIODevice *out, QCryptographicHash &hash, QString &error) {
+    QFile in(path);
+    if (!in.open(QIODevice::ReadOnly)) {
+        error = u8"无法读取附件：" + path;
+        return false;
+    }
+    while (!in.atEnd()) {
+        const QByteArray chunk = in.read(ChunkSize);
+        if (chunk.isEmpty()) {
+            error = u8"读取附件失败：" + in.errorString();
+            return false;
+        }
+        if (!writeChunk(out, hash, chunk)) {
+            error = u8"写入缓存文件失败：" + out->errorString();
+            return false;
+        }
+    }
+    return true;
+}
+
+// 缓存文件扩展名：优先按MIME类型，其次按外部文件扩展名
+QString ReqObjectStore::suffixFor(const ReqEmbeddedObject &object) {
+    if (!object.mimeType.isEmpty()) {
+        const QString suffix = QMimeDatabase().mimeTypeForName(object.mimeType).preferredSuffix();
+        if (!suffix.isEmpty()) return suffix;
+    }
+    const QString suffix = QFileInfo(object.dataRef).suffix();
+    return suffix.isEmpty() ? QString("bin") : suffix.toLower();
+}
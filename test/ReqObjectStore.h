@@ -0,0 +1,64 @@
+﻿#ifndef REQOBJECTSTORE_H
+#define REQOBJECTSTORE_H
+
+#include <QString>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+#include "ReqifRawFile.h"
+
+class QIODevice;
+class QCryptographicHash;
+
+// 描述中嵌入的XHTML对象（<object data=...>）
+struct ReqEmbeddedObject {
+    QString reqId;               // 所属需求ID
+    int ordinal = 0;             // 在所属SPEC-OBJECT内的序号（按文档顺序）
+    QString mimeType;            // MIME类型（type属性或data URI中的类型）
+    QString dataRef;             // 外部文件引用（内联base64时为空）
+    bool isImage() const { return mimeType.startsWith("image/"); }
+};
+
+// 嵌入对象存储：解析时只记录对象位置，首次查看时才从源文件流式解码
+// 解码结果按内容SHA-1存放在缓存目录，相同内容只保存一份；可从后台渲染线程并发调用
+// 锁只保护索引查找与登记，解码和写缓存文件在锁外进行，不同对象可以并行提取
+class ReqObjectStore
+{
+public:
+    ReqObjectStore();
+
+    void reset(const QString &sourcePath);               // 切换源文件并清空索引
+    void takeIndex(ReqObjectStore &other);               // 接管另一存储的对象索引（重新加载时使用）
+    void add(const ReqEmbeddedObject &object);           // 记录对象
+    QList<ReqEmbeddedObject> objects(const QString &reqId) const; // 需求的全部对象
+    int count() const;                                   // 对象总数
+
+    void setCacheDir(const QString &dir);                // 缓存目录（默认为系统缓存目录下的objects）
+    QString cacheDir() const;
+    QString extract(const ReqEmbeddedObject &object);    // 提取到缓存，返回本地文件路径（失败返回空）
+    QString errorString() const;
+
+private:
+    bool locateInlineData(const ReqEmbeddedObject &object, ReqifByteRange &base64); // 定位内联base64字节区间（持锁调用）
+    QString resolveExternal(const QString &dataRef);     // 外部文件引用的本地路径（越出源文件目录时返回空，持锁调用）
+    void setError(const QString &error);                 // 记录错误（加锁）
+    static bool decodeBase64(const char *data, const ReqifByteRange &range, QIODevice *out,
+                             QCryptographicHash &hash, QString &error); // 流式解码
+    static bool copyFile(const QString &path, QIODevice *out, QCryptographicHash &hash, QString &error); // 流式拷贝外部文件
+    static QString suffixFor(const ReqEmbeddedObject &object); // 缓存文件扩展名
+
+private:
+    QString m_sourcePath;                                // 源ReqIF文件
+    QHash<QString, QList<ReqEmbeddedObject>> m_objects;  // 需求ID -> 对象列表
+    int m_count = 0;
+    QSharedPointer<ReqifRawFile> m_raw;                  // 源文件字节（首次提取时映射；解码中的线程持有引用，重置时不会失效）
+    QHash<QString, ReqifByteRange> m_specObjectRanges;   // SPEC-OBJECT字节区间（首次提取时建立）
+    QHash<QString, QString> m_extracted;                 // "需求ID#序号" -> 缓存文件路径
+    QString m_cacheDir;
+    QString m_errorString;
+    int m_generation = 0;                                // reset()时递增，丢弃重置前开始的提取结果
+    mutable QMutex m_mutex;                              // 保护以上成员（递归锁）
+};
+
+#endif // REQOBJECTSTORE_H
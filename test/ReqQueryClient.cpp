@@ -0,0 +1,118 @@
+﻿#include "ReqQueryClient.h"
+#include "ReqQueryProtocol.h"
+#include <QElapsedTimer>
+
+ReqQueryClient::ReqQueryClient(QObject *parent) : QObject(parent)
+{
+}
+
+// 连接守护进程
+bool ReqQueryClient::connectToServer(const QString &serverName, int timeoutMs) {
+    m_buffer.clear();
+    m_socket.connectToServer(serverName.isEmpty() ? ReqQueryProtocol::defaultServerName() : serverName);
+    if (!m_socket.waitForConnected(timeoutMs)) {
+        m_errorString = m_socket.errorString();
+        return false;
+    }
+    return true;
+}
+
+void ReqQueryClient::disconnectFromServer() {
+    m_socket.disconnectFromServer();
+}
+
+bool ReqQueryClient::isConnected() const {
+    return m_socket.state() == QLocalSocket::ConnectedState;
+}
+
+QString ReqQueryClient::errorString() const {
+    return m_errorString;
+}
+
+void ReqQueryClient::setTimeout(int timeoutMs) {
+    m_timeoutMs = timeoutMs;
+}
+
+// 通用请求：写出一帧后等待同序号的应答
+QJsonObject ReqQueryClient::request(const QJsonObject &request) {
+    QJsonObject message = request;
+    const int seq = ++m_seq;
+    message.insert("seq", seq);
+
+    if (!isConnected() || !ReqQueryProtocol::writeFrame(&m_socket, message)) {
+        m_errorString = u8"未连接到查询服务";
+        return QJsonObject();
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QJsonObject response;
+    bool error = false;
+    for (;;) {
+        while (ReqQueryProtocol::takeFrame(m_buffer, response, &error)) {
+            if (response.value("seq").toInt() == seq) {
+                if (!response.value("ok").toBool()) {
+                    m_errorString = response.value("error").toString();
+                }
+                return response;
+            }
+        }
+        const int remaining = m_timeoutMs - int(timer.elapsed());
+        if (error || remaining <= 0 || !m_socket.waitForReadyRead(remaining)) {
+            m_errorString = error ? u8"应答格式错误" : u8"等待应答超时";
+            return QJsonObject();
+        }
+        m_buffer += m_socket.readAll();
+    }
+}
+
+// 守护进程常驻的文档
+QStringList ReqQueryClient::documents() {
+    QJsonObject req;
+    req.insert("op", "list");
+    QStringList docs;
+    foreach (const QJsonValue &doc, result(req).toArray()) {
+        docs.append(doc.toString());
+    }
+    return docs;
+}
+
+QJsonObject ReqQueryClient::lookup(const QString &reqId, const QString &doc) {
+    QJsonObject req;
+    req.insert("op", "lookup");
+    req.insert("doc", doc);
+    req.insert("req", reqId);
+    return result(req).toObject();
+}
+
+QJsonValue ReqQueryClient::subtree(const QString &reqId, int depth, const QString &doc) {
+    QJsonObject req;
+    req.insert("op", "subtree");
+    req.insert("doc", doc);
+    req.insert("req", reqId);
+    req.insert("depth", depth);
+    return result(req);
+}
+
+QJsonArray ReqQueryClient::search(const QString &text, bool includeDescription, const QString &doc) {
+    QJsonObject req;
+    req.insert("op", "search");
+    req.insert("doc", doc);
+    req.insert("text", text);
+    req.insert("description", includeDescription);
+    return result(req).toArray();
+}
+
+QString ReqQueryClient::description(const QString &reqId, const QString &doc) {
+    QJsonObject req;
+    req.insert("op", "description");
+    req.insert("doc", doc);
+    req.insert("req", reqId);
+    return result(req).toString();
+}
+
+// 发起请求并取出result
+QJsonValue ReqQueryClient::result(const QJsonObject &request) {
+    const QJsonObject response = this->request(request);
+    return response.value("ok").toBool() ? response.value("result") : QJsonValue();
+}
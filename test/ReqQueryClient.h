@@ -0,0 +1,42 @@
+﻿#ifndef REQQUERYCLIENT_H
+#define REQQUERYCLIENT_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QLocalSocket>
+
+// 需求查询客户端：连接常驻守护进程，以同步方式发起查询
+class ReqQueryClient : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ReqQueryClient(QObject *parent = nullptr);
+
+    bool connectToServer(const QString &serverName = QString(), int timeoutMs = 3000); // 连接守护进程
+    void disconnectFromServer();                        // 断开连接
+    bool isConnected() const;                           // 是否已连接
+    QString errorString() const;                        // 最近一次错误信息
+    void setTimeout(int timeoutMs);                     // 单次请求超时
+
+    QJsonObject request(const QJsonObject &request);    // 通用请求（返回完整应答）
+
+    // 便捷查询（失败时返回空值，可通过errorString获取原因）
+    QStringList documents();                            // 守护进程常驻的文档
+    QJsonObject lookup(const QString &reqId, const QString &doc = QString());
+    QJsonValue subtree(const QString &reqId = QString(), int depth = -1, const QString &doc = QString());
+    QJsonArray search(const QString &text, bool includeDescription = false, const QString &doc = QString());
+    QString description(const QString &reqId, const QString &doc = QString());
+
+private:
+    QJsonValue result(const QJsonObject &request);      // 发起请求并取出result
+
+private:
+    QLocalSocket m_socket;                              // 本地连接
+    QByteArray m_buffer;                                // 未处理的应答数据
+    QString m_errorString;                              // 最近一次错误信息
+    int m_timeoutMs = 10000;                            // 单次请求超时
+    int m_seq = 0;                                      // 请求序号
+};
+
+#endif // REQQUERYCLIENT_H
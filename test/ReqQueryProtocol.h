@@ -0,0 +1,57 @@
+﻿#ifndef REQQUERYPROTOCOL_H
+#define REQQUERYPROTOCOL_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtEndian>
+
+// 查询守护进程通信协议：每帧 = 4字节大端长度 + 紧凑JSON对象
+//   请求：{"seq":n, "op":"lookup|subtree|search|description|list", "doc":文件路径, ...}
+//   应答：{"seq":n, "ok":true, "result":...} 或 {"seq":n, "ok":false, "error":"..."}
+namespace ReqQueryProtocol {
+
+// 默认本地服务名
+inline QString defaultServerName() {
+    return QStringLiteral("reqif-query");
+}
+
+// 单帧上限，防止异常数据导致无限缓存
+const quint32 MaxFrameSize = 64 * 1024 * 1024;
+
+// 写出一帧
+inline bool writeFrame(QIODevice *device, const QJsonObject &message) {
+    const QByteArray payload = QJsonDocument(message).toJson(QJsonDocument::Compact);
+    uchar header[4];
+    qToBigEndian(quint32(payload.size()), header);
+    return device->write(reinterpret_cast<const char *>(header), 4) == 4 &&
+           device->write(payload) == payload.size();
+}
+
+// 从缓冲区取出一帧（数据不足返回false；帧格式错误时置error）
+inline bool takeFrame(QByteArray &buffer, QJsonObject &message, bool *error = nullptr) {
+    if (error) *error = false;
+    if (buffer.size() < 4) return false;
+
+    const quint32 length = qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(buffer.constData()));
+    if (length > MaxFrameSize) {
+        if (error) *error = true;
+        return false;
+    }
+    if (quint32(buffer.size()) < 4 + length) return false;
+
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(buffer.mid(4, int(length)), &parseError);
+    buffer.remove(0, int(4 + length));
+    if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+        if (error) *error = true;
+        return false;
+    }
+    message = doc.object();
+    return true;
+}
+
+} // namespace ReqQueryProtocol
+
+#endif // REQQUERYPROTOCOL_H
@@ -0,0 +1,314 @@
+﻿#include "ReqQueryServer.h"
+#include "ReqQueryProtocol.h"
+#include <QFileInfo>
+#include <QTimer>
+#include <QDebug>
+#include <QtConcurrent>
+
+ReqQueryServer::ReqQueryServer(QObject *parent)
+    : QObject(parent)
+    , m_server(new QLocalServer(this))
+    , m_watcher(new QFileSystemWatcher(this))
+    , m_reloadTimer(new QTimer(this))
+{
+    connect(m_server, &QLocalServer::newConnection, this, &ReqQueryServer::onNewConnection);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &ReqQueryServer::onFileChanged);
+    m_reloadTimer->setSingleShot(true);
+    m_reloadTimer->setInterval(500);
+    connect(m_reloadTimer, &QTimer::timeout, this, &ReqQueryServer::onReloadPending);
+}
+
+ReqQueryServer::~ReqQueryServer() {
+    // 等待后台加载结束后再释放解析器
+    for (const PendingReload &reload : m_reloads) {
+        reload.watcher->waitForFinished();
+        delete reload.parser;
+    }
+    qDeleteAll(m_docs);
+}
+
+// 创建解析器（工作线程中加载，不弹窗）
+ReqifParser *ReqQueryServer::createParser() {
+    ReqifParser *parser = new ReqifParser();
+    parser->setInteractive(false);
+    parser->setStringPool(&m_stringPool);
+    return parser;
+}
+
+// 新数据就绪后再替换，查询不会看到加载中的状态
+void ReqQueryServer::installDocument(const QString &path, ReqifParser *parser) {
+    ReqifParser *old = m_docs.value(path);
+    m_docs.insert(path, parser);
+    if (old) {
+        delete old;
+        m_stringPool.prune();
+    }
+    if (!m_watcher->files().contains(path)) {
+        m_watcher->addPath(path);
+    }
+    qDebug() << u8"已加载文档：" << path << u8"需求数：" << parser->getAllReqCount();
+}
+
+// 开始监听
+bool ReqQueryServer::listen(const QString &serverName) {
+    QLocalServer::removeServer(serverName); // 清理异常退出残留的套接字
+    if (!m_server->listen(serverName)) {
+        m_errorString = m_server->errorString();
+        return false;
+    }
+    qDebug() << u8"查询服务已启动：" << m_server->fullServerName();
+    return true;
+}
+
+// 加载并常驻文档
+bool ReqQueryServer::openDocument(const QString &filePath) {
+    const QString path = canonicalPath(filePath);
+    ReqifParser *parser = createParser();
+    if (!parser->load(path)) {
+        m_errorString = parser->errorString().isEmpty() ? QString(u8"文件中没有有效需求") : parser->errorString();
+        delete parser;
+        return false;
+    }
+    installDocument(path, parser);
+    return true;
+}
+
+// 已常驻的文档路径
+QStringList ReqQueryServer::documents() const {
+    return m_docs.keys();
+}
+
+QString ReqQueryServer::errorString() const {
+    return m_errorString;
+}
+
+// 新客户端连接
+void ReqQueryServer::onNewConnection() {
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        m_buffers.insert(socket, QByteArray());
+        connect(socket, &QLocalSocket::readyRead, this, &ReqQueryServer::onReadyRead);
+        connect(socket, &QLocalSocket::disconnected, this, &ReqQueryServer::onDisconnected);
+    }
+}
+
+// 客户端请求到达：按帧解析并逐一应答
+void ReqQueryServer::onReadyRead() {
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    if (!socket) return;
+
+    QByteArray &buffer = m_buffers[socket];
+    buffer += socket->readAll();
+
+    QJsonObject request;
+    bool error = false;
+    while (ReqQueryProtocol::takeFrame(buffer, request, &error)) {
+        ReqQueryProtocol::writeFrame(socket, handleRequest(request));
+    }
+    if (error) {
+        qWarning() << u8"收到无效请求帧，断开连接";
+        socket->disconnectFromServer();
+    }
+}
+
+// 客户端断开
+void ReqQueryServer::onDisconnected() {
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    if (!socket) return;
+    m_buffers.remove(socket);
+    socket->deleteLater();
+}
+
+// 文档文件变化：导出工具通常分多次写入，每次变化重新计时，停止变化后再加载
+void ReqQueryServer::onFileChanged(const QString &filePath) {
+    m_pendingReloads.insert(filePath);
+    m_reloadTimer->start();
+}
+
+// 在线程池中重新加载变化的文档，期间继续用旧数据应答查询（失败时保留旧数据）
+void ReqQueryServer::onReloadPending() {
+    const QSet<QString> paths = m_pendingReloads;
+    m_pendingReloads.clear();
+
+    bool replacing = false;
+    foreach (const QString &path, paths) {
+        if (m_reloads.contains(path)) {
+            // 上一次加载尚未结束，完成后再加载一次
+            m_pendingReloads.insert(path);
+            continue;
+        }
+        if (!QFileInfo::exists(path)) {
+            // 文件尚在替换中，稍后重试（此时加载必然失败，且之后无法重新添加监视）
+            m_pendingReloads.insert(path);
+            replacing = true;
+            continue;
+        }
+        // 替换式保存会使监视失效，需要重新添加
+        if (!m_watcher->files().contains(path)) {
+            m_watcher->addPath(path);
+        }
+
+        PendingReload reload;
+        reload.parser = createParser();
+        reload.watcher = new QFutureWatcher<bool>(this);
+        connect(reload.watcher, &QFutureWatcher<bool>::finished, this, [this, path]() {
+            onReloadFinished(path);
+        });
+        m_reloads.insert(path, reload);
+        ReqifParser *parser = reload.parser;
+        reload.watcher->setFuture(QtConcurrent::run([parser, path]() { return parser->load(path); }));
+    }
+    if (replacing) {
+        m_reloadTimer->start();
+    }
+}
+
+// 后台重新加载完成：成功时替换文档；加载期间又有变化时重新计时
+void ReqQueryServer::onReloadFinished(const QString &path) {
+    const PendingReload reload = m_reloads.take(path);
+    reload.watcher->deleteLater();
+    if (reload.watcher->result()) {
+        installDocument(path, reload.parser);
+    } else {
+        const QString error = reload.parser->errorString().isEmpty() ? QString(u8"文件中没有有效需求")
+                                                                     : reload.parser->errorString();
+        qWarning() << u8"重新加载失败，继续使用旧数据：" << path << error;
+        delete reload.parser;
+    }
+    if (!m_pendingReloads.isEmpty()) {
+        m_reloadTimer->start();
+    }
+}
+
+// 分发请求
+QJsonObject ReqQueryServer::handleRequest(const QJsonObject &request) {
+    QJsonObject response;
+    response.insert("seq", request.value("seq"));
+
+    const QString op = request.value("op").toString();
+    if (op == "list") {
+        response.insert("ok", true);
+        response.insert("result", QJsonArray::fromStringList(documents()));
+        return response;
+    }
+
+    ReqifParser *parser = findDocument(request.value("doc").toString());
+    if (!parser) {
+        response.insert("ok", false);
+        response.insert("error", QString(u8"文档未加载：%1").arg(request.value("doc").toString()));
+        return response;
+    }
+
+    const QString reqId = request.value("req").toString();
+    ReqData req;
+
+    if (op == "lookup") {
+        if (!parser->getReq(reqId, req)) {
+            response.insert("ok", false);
+            response.insert("error", QString(u8"未找到需求：%1").arg(reqId));
+            return response;
+        }
+        response.insert("result", reqToJson(req));
+    }
+    else if (op == "subtree") {
+        const int depth = request.value("depth").toInt(-1); // 负数表示不限深度
+        if (reqId.isEmpty()) {
+            QJsonArray roots;
+            QSet<QString> ancestors;
+            foreach (const QString &topId, parser->getTopReqIds()) {
+                roots.append(subtreeToJson(parser, topId, depth, ancestors));
+            }
+            response.insert("result", roots);
+        } else if (parser->getReq(reqId, req)) {
+            QSet<QString> ancestors;
+            response.insert("result", subtreeToJson(parser, reqId, depth, ancestors));
+        } else {
+            response.insert("ok", false);
+            response.insert("error", QString(u8"未找到需求：%1").arg(reqId));
+            return response;
+        }
+    }
+    else if (op == "search") {
+        QJsonArray hits;
+        foreach (const QString &hitId, parser->findReqs(request.value("text").toString(),
+                                                        request.value("description").toBool())) {
+            if (parser->getReq(hitId, req)) {
+                QJsonObject hit;
+                hit.insert("id", req.id);
+                hit.insert("name", req.name);
+                hits.append(hit);
+            }
+        }
+        response.insert("result", hits);
+    }
+    else if (op == "description") {
+        if (!parser->getReq(reqId, req)) {
+            response.insert("ok", false);
+            response.insert("error", QString(u8"未找到需求：%1").arg(reqId));
+            return response;
+        }
+        response.insert("result", parser->getReqDescription(reqId));
+    }
+    else {
+        response.insert("ok", false);
+        response.insert("error", QString(u8"未知操作：%1").arg(op));
+        return response;
+    }
+
+    response.insert("ok", true);
+    return response;
+}
+
+// 查找文档（路径为空且仅有一个文档时取该文档）
+ReqifParser *ReqQueryServer::findDocument(const QString &filePath) const {
+    if (filePath.isEmpty()) {
+        return m_docs.size() == 1 ? m_docs.constBegin().value() : nullptr;
+    }
+    return m_docs.value(canonicalPath(filePath));
+}
+
+// 需求 -> JSON
+QJsonObject ReqQueryServer::reqToJson(const ReqData &req) const {
+    QJsonObject obj;
+    obj.insert("id", req.id);
+    obj.insert("name", req.name);
+    obj.insert("description", req.description);
+    obj.insert("sortNum", req.sortNum);
+    obj.insert("level", req.level);
+    obj.insert("parentId", req.parentId);
+    return obj;
+}
+
+// 子树 -> JSON（不含描述，按需通过description查询）
+// 多个层次结构给出矛盾的父子关系时父->子索引可能成环，路径上已出现的需求不再展开（标记cycle）
+QJsonObject ReqQueryServer::subtreeToJson(const ReqifParser *parser, const QString &reqId, int depth,
+                                          QSet<QString> &ancestors) const {
+    ReqData req;
+    parser->getReq(reqId, req);
+
+    QJsonObject node;
+    node.insert("id", reqId);
+    node.insert("name", req.name);
+    node.insert("sortNum", req.sortNum);
+    node.insert("level", req.level);
+
+    if (ancestors.contains(reqId)) {
+        node.insert("cycle", true);
+        return node;
+    }
+    if (depth != 0) {
+        ancestors.insert(reqId);
+        QJsonArray children;
+        foreach (const QString &childId, parser->getChildIds(reqId)) {
+            children.append(subtreeToJson(parser, childId, depth - 1, ancestors));
+        }
+        ancestors.remove(reqId);
+        node.insert("children", children);
+    }
+    return node;
+}
+
+// 统一文档路径（软链接、相对路径指向同一文件时共享同一份数据）
+QString ReqQueryServer::canonicalPath(const QString &filePath) {
+    const QString canonical = QFileInfo(filePath).canonicalFilePath();
+    return canonical.isEmpty() ? QFileInfo(filePath).absoluteFilePath() : canonical;
+}
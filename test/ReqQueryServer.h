@@ -0,0 +1,67 @@
+﻿#ifndef REQQUERYSERVER_H
+#define REQQUERYSERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include "ReqifParser.h"
+#include "ReqStringPool.h"
+
+// 需求查询守护进程：常驻解析结果，监视文件变化，通过QLocalServer响应查询
+class QTimer;
+
+class ReqQueryServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ReqQueryServer(QObject *parent = nullptr);
+    ~ReqQueryServer();
+
+    bool listen(const QString &serverName);             // 开始监听（同名残留服务会被清理）
+    bool openDocument(const QString &filePath);         // 加载并常驻文档（同步，启动时使用）
+    QStringList documents() const;                      // 已常驻的文档路径
+    QString errorString() const;                        // 最近一次错误信息
+
+private slots:
+    void onNewConnection();                             // 新客户端连接
+    void onReadyRead();                                 // 客户端请求到达
+    void onDisconnected();                              // 客户端断开
+    void onFileChanged(const QString &filePath);        // 文档文件变化
+    void onReloadPending();                             // 合并短时间内的多次变化后重新加载
+
+private:
+    // 后台重新加载中的文档：解析器在工作线程中加载，完成后在主线程替换
+    struct PendingReload {
+        ReqifParser *parser = nullptr;
+        QFutureWatcher<bool> *watcher = nullptr;
+    };
+
+    ReqifParser *createParser();                             // 创建按服务设置配置的解析器
+    void installDocument(const QString &path, ReqifParser *parser); // 以加载好的解析器替换文档
+    void onReloadFinished(const QString &path);              // 后台重新加载完成
+    QJsonObject handleRequest(const QJsonObject &request);   // 分发请求
+    ReqifParser *findDocument(const QString &filePath) const; // 查找文档（路径为空时取唯一文档）
+    QJsonObject reqToJson(const ReqData &req) const;         // 需求 -> JSON
+    QJsonObject subtreeToJson(const ReqifParser *parser, const QString &reqId, int depth,
+                              QSet<QString> &ancestors) const; // 子树 -> JSON（ancestors为当前路径，遇到环时截断）
+    static QString canonicalPath(const QString &filePath);   // 统一文档路径
+
+private:
+    QLocalServer *m_server;                             // 本地服务
+    QFileSystemWatcher *m_watcher;                      // 文件监视
+    QHash<QString, ReqifParser*> m_docs;                // 常驻文档（路径 -> 解析器）
+    ReqStringPool m_stringPool;                         // 文档间共享的字符串驻留池
+    QHash<QLocalSocket*, QByteArray> m_buffers;         // 各连接未处理的数据
+    QSet<QString> m_pendingReloads;                     // 待重新加载的文档
+    QTimer *m_reloadTimer;                              // 重新加载防抖定时器（每次变化重新计时）
+    QHash<QString, PendingReload> m_reloads;            // 后台重新加载中的文档
+    QString m_errorString;                              // 最近一次错误信息
+};
+
+#endif // REQQUERYSERVER_H
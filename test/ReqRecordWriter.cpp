@@ -0,0 +1,195 @@
+﻿#include "ReqRecordWriter.h"
+#include "ReqifParser.h"
+#include <QFileInfo>
+
+ReqRecordWriter::ReqRecordWriter(QIODevice *device, Format format)
+    : m_device(device)
+    , m_format(format)
+{
+    m_buffer.reserve(m_bufferSize);
+}
+
+ReqRecordWriter::~ReqRecordWriter() {
+    if (!m_finished && !m_failed) flush();
+}
+
+// 按扩展名判断格式
+ReqRecordWriter::Format ReqRecordWriter::formatForFile(const QString &filePath) {
+    const QString suffix = QFileInfo(filePath).suffix().toLower();
+    if (suffix == "csv") return Csv;
+    if (suffix == "json") return Json;
+    return Ndjson;
+}
+
+void ReqRecordWriter::setBufferSize(int bytes) {
+    m_bufferSize = qMax(4096, bytes);
+    m_buffer.reserve(m_bufferSize);
+}
+
+void ReqRecordWriter::setHierarchyKnown(bool known) {
+    m_hierarchyKnown = known;
+}
+
+// 写出表头/数组起始
+bool ReqRecordWriter::begin() {
+    m_count = 0;
+    m_finished = false;
+    m_failed = false;
+    m_buffer.resize(0);
+    if (m_format == Csv) {
+        m_buffer += "id,name,description,sortNum,level,parentId,path\r\n";
+    } else if (m_format == Json) {
+        m_buffer += '[';
+    }
+    return true;
+}
+
+// 写出一条需求
+bool ReqRecordWriter::write(const ReqData &req, const QString &path) {
+    if (m_failed) return false;
+    if (m_format == Csv) {
+        appendCsvField(req.id);
+        m_buffer += ',';
+        appendCsvField(req.name);
+        m_buffer += ',';
+        appendCsvField(req.description);
+        m_buffer += ',';
+        m_buffer += QByteArray::number(req.sortNum);
+        m_buffer += ',';
+        if (m_hierarchyKnown) {
+            m_buffer += QByteArray::number(req.level);
+            m_buffer += ',';
+            appendCsvField(req.parentId);
+            m_buffer += ',';
+            appendCsvField(path);
+        } else {
+            m_buffer += ",,";
+        }
+        m_buffer += "\r\n";
+    } else {
+        if (m_format == Json) m_buffer += m_count > 0 ? ",\n" : "\n";
+        m_buffer += "{\"id\":";
+        appendJsonString(req.id);
+        m_buffer += ",\"name\":";
+        appendJsonString(req.name);
+        m_buffer += ",\"description\":";
+        appendJsonString(req.description);
+        m_buffer += ",\"sortNum\":";
+        m_buffer += QByteArray::number(req.sortNum);
+        if (m_hierarchyKnown) {
+            m_buffer += ",\"level\":";
+            m_buffer += QByteArray::number(req.level);
+            m_buffer += ",\"parentId\":";
+            appendJsonString(req.parentId);
+            m_buffer += ",\"path\":";
+            appendJsonString(path);
+        } else {
+            m_buffer += ",\"level\":null,\"parentId\":null,\"path\":null";
+        }
+        m_buffer += '}';
+        if (m_format == Ndjson) m_buffer += '\n';
+    }
+    ++m_count;
+
+    return m_buffer.size() < m_bufferSize || flush();
+}
+
+// 写出结尾并刷新缓冲
+bool ReqRecordWriter::finish() {
+    m_finished = true;
+    if (m_failed) return false;
+    if (m_format == Json) m_buffer += "\n]\n";
+    return flush();
+}
+
+// 因数据源错误中止导出，已缓冲的内容不再写出
+void ReqRecordWriter::fail(const QString &error) {
+    m_errorString = error;
+    m_failed = true;
+}
+
+qint64 ReqRecordWriter::recordCount() const {
+    return m_count;
+}
+
+QString ReqRecordWriter::errorString() const {
+    return m_errorString;
+}
+
+// 追加JSON字符串：转义引号、反斜杠和控制字符，其余按UTF-8原样输出
+void ReqRecordWriter::appendJsonString(const QString &text) {
+    static const char hex[] = "0123456789abcdef";
+    const QByteArray utf8 = text.toUtf8();
+
+    m_buffer += '"';
+    const char *begin = utf8.constData();
+    const char *end = begin + utf8.size();
+    const char *plain = begin; // 尚未追加的无需转义片段起点
+    for (const char *p = begin; p != end; ++p) {
+        const uchar c = uchar(*p);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        m_buffer.append(plain, int(p - plain));
+        plain = p + 1;
+        switch (c) {
+        case '"':  m_buffer += "\\\""; break;
+        case '\\': m_buffer += "\\\\"; break;
+        case '\n': m_buffer += "\\n"; break;
+        case '\r': m_buffer += "\\r"; break;
+        case '\t': m_buffer += "\\t"; break;
+        default:
+            m_buffer += "\\u00";
+            m_buffer += hex[c >> 4];
+            m_buffer += hex[c & 0xF];
+            break;
+        }
+    }
+    m_buffer.append(plain, int(end - plain));
+    m_buffer += '"';
+}
+
+// 追加CSV字段：含逗号、引号或换行时加引号，引号双写
+void ReqRecordWriter::appendCsvField(const QString &text) {
+    const QByteArray utf8 = text.toUtf8();
+    bool needQuote = false;
+    for (const char c : utf8) {
+        if (c == ',' || c == '"' || c == '\n' || c == '\r') {
+            needQuote = true;
+            break;
+        }
+    }
+    if (!needQuote) {
+        m_buffer += utf8;
+        return;
+    }
+
+    m_buffer += '"';
+    const char *plain = utf8.constData();
+    const char *end = plain + utf8.size();
+    for (const char *p = plain; p != end; ++p) {
+        if (*p == '"') {
+            m_buffer.append(plain, int(p - plain + 1));
+            m_buffer += '"';
+            plain = p + 1;
+        }
+    }
+    m_buffer.append(plain, int(end - plain));
+    m_buffer += '"';
+}
+
+// 缓冲区整块写入设备；写入不完整（磁盘满等）同样视为失败，之后不再接受记录
+bool ReqRecordWriter::flush() {
+    if (m_failed) return false;
+    if (m_buffer.isEmpty()) return true;
+    const qint64 written = m_device->write(m_buffer);
+    if (written != m_buffer.size()) {
+        m_errorString = m_device->errorString();
+        if (m_errorString.isEmpty() || written >= 0) {
+            m_errorString = QString(u8"写入不完整：%1/%2字节").arg(qMax<qint64>(written, 0)).arg(m_buffer.size());
+        }
+        m_failed = true;
+        return false;
+    }
+    m_buffer.resize(0); // 保留容量，避免反复分配
+    return true;
+}
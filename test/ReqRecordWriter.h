@@ -0,0 +1,54 @@
+﻿#ifndef REQRECORDWRITER_H
+#define REQRECORDWRITER_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QString>
+
+struct ReqData;
+
+// 需求记录流式导出：NDJSON / CSV / JSON数组
+// 字段：id, name, description, sortNum, level, parentId, path
+// 层次未知时（边解析边导出）level/parentId/path在JSON中为null、在CSV中为空
+// 输出先写入固定大小的缓冲区，满后整块写入设备，额外内存与需求数量无关
+class ReqRecordWriter
+{
+public:
+    enum Format {
+        Ndjson,                                          // 每行一个JSON对象
+        Csv,                                             // RFC 4180 CSV（首行为表头）
+        Json                                             // 单个JSON数组
+    };
+
+    ReqRecordWriter(QIODevice *device, Format format);
+    ~ReqRecordWriter();
+
+    static Format formatForFile(const QString &filePath); // 按扩展名判断格式（默认NDJSON）
+
+    void setBufferSize(int bytes);                       // 写入块大小（默认1MB）
+    void setHierarchyKnown(bool known);                  // 层次字段是否有效（默认有效）
+    bool begin();                                        // 写出表头/数组起始
+    bool write(const ReqData &req, const QString &path); // 写出一条需求
+    bool finish();                                       // 写出结尾并刷新缓冲
+    void fail(const QString &error);                     // 因数据源错误中止导出（之后的写入均失败）
+    qint64 recordCount() const;                          // 已写出的需求数
+    QString errorString() const;                         // 写入失败原因
+
+private:
+    void appendJsonString(const QString &text);          // 追加JSON字符串（含引号与转义）
+    void appendCsvField(const QString &text);            // 追加CSV字段（按需加引号）
+    bool flush();                                        // 缓冲区整块写入设备
+
+private:
+    QIODevice *m_device;
+    Format m_format;
+    QByteArray m_buffer;                                 // 写入缓冲
+    int m_bufferSize = 1024 * 1024;
+    qint64 m_count = 0;
+    bool m_finished = false;
+    bool m_hierarchyKnown = true;
+    bool m_failed = false;                               // 写入失败后不再接受记录
+    QString m_errorString;
+};
+
+#endif // REQRECORDWRITER_H
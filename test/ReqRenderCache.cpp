@@ -0,0 +1,166 @@
+﻿#include "ReqRenderCache.h"
+#include <QFileInfo>
+#include <QtConcurrent>
+#include <climits>
+
+ReqRenderCache::ReqRenderCache(ReqifParser *parser, QObject *parent)
+    : QObject(parent)
+    , m_parser(parser)
+{
+    m_cache.setMaxCost(64 * 1024);
+    connect(&m_watcher, &QFutureWatcher<RenderResults>::finished, this, &ReqRenderCache::onPrefetchFinished);
+}
+
+ReqRenderCache::~ReqRenderCache() {
+    m_watcher.waitForFinished();
+}
+
+void ReqRenderCache::setMaxCostKb(int kb) {
+    m_cache.setMaxCost(kb);
+}
+
+// 切换渲染的文档：缓存以需求ID为键，不同文档间不能混用
+// 等待进行中的预渲染结束，之后旧文档可以安全关闭
+void ReqRenderCache::setParser(ReqifParser *parser) {
+    if (parser == m_parser) return;
+    clear();
+    m_watcher.waitForFinished();
+    m_parser = parser;
+}
+
+ReqifParser *ReqRenderCache::parser() const {
+    return m_parser;
+}
+
+// 取出渲染结果：命中时从缓存移出，否则在当前线程渲染
+QTextDocument *ReqRenderCache::take(const QString &reqId) {
+    QTextDocument *doc = m_cache.take(reqId);
+    return doc ? doc : build(prepare(m_parser, makeJob(reqId)));
+}
+
+// 归还文档到缓存（超出上限时由QCache删除）
+void ReqRenderCache::give(const QString &reqId, QTextDocument *doc) {
+    if (!doc) return;
+    m_cache.insert(reqId, doc, costKb(doc));
+}
+
+// 后台预渲染：只保留最新一次请求，正在进行的任务完成后再启动
+void ReqRenderCache::prefetch(const QStringList &reqIds) {
+    m_queued.clear();
+    foreach (const QString &reqId, reqIds) {
+        if (!m_cache.contains(reqId)) {
+            m_queued.append(makeJob(reqId));
+        }
+    }
+    if (!m_watcher.isRunning()) {
+        startPrefetch();
+    }
+}
+
+// 清空缓存，正在进行的预渲染结果完成后丢弃
+void ReqRenderCache::clear() {
+    ++m_generation;
+    m_queued.clear();
+    m_cache.clear();
+}
+
+// 预渲染完成，在主线程构建文档放入缓存
+void ReqRenderCache::onPrefetchFinished() {
+    const RenderResults results = m_watcher.result();
+    if (m_runningGeneration == m_generation) {
+        foreach (const PreparedDoc &prepared, results) {
+            if (!m_cache.contains(prepared.reqId)) {
+                QTextDocument *doc = build(prepared);
+                m_cache.insert(prepared.reqId, doc, costKb(doc));
+            }
+        }
+    }
+    startPrefetch();
+}
+
+// 在主线程收集渲染输入，后台线程不直接访问需求存储
+ReqRenderCache::RenderJob ReqRenderCache::makeJob(const QString &reqId) const {
+    RenderJob job;
+    job.reqId = reqId;
+    job.html = m_parser->getReqRichDescription(reqId);
+    job.plainText = m_parser->getReqDescription(reqId);
+    job.objects = m_parser->getReqObjects(reqId);
+    return job;
+}
+
+// 准备渲染输入：富文本中的图片占位替换为缓存文件，其余嵌入对象追加为附件链接；图片在此解码
+// 只使用QString/QImage，可在后台线程执行（QTextDocument由build()在主线程创建）
+ReqRenderCache::PreparedDoc ReqRenderCache::prepare(ReqifParser *parser, const RenderJob &job) {
+    PreparedDoc prepared;
+    prepared.reqId = job.reqId;
+    QString &html = prepared.html;
+    html = job.html.isEmpty()
+           ? QString("<div style=\"white-space: pre-wrap;\">%1</div>").arg(job.plainText.toHtmlEscaped())
+           : job.html;
+
+    foreach (const ReqEmbeddedObject &object, job.objects) {
+        const QString placeholder = QString("\"reqobj:%1\"").arg(object.ordinal);
+        const bool inlined = html.contains(placeholder);
+        const QString path = parser->extractObject(object);
+        if (path.isEmpty()) {
+            if (inlined) html.replace(placeholder, "\"\"");
+            html += u8"<p>[嵌入对象无法提取]</p>";
+            continue;
+        }
+
+        const QUrl fileUrl = QUrl::fromLocalFile(path);
+        const QString url = fileUrl.toString().toHtmlEscaped();
+        if (object.isImage()) {
+            // 解码失败时不登记资源，由QTextDocument按文件链接自行加载
+            const QImage image(path);
+            if (!image.isNull()) {
+                prepared.images.append(qMakePair(fileUrl, image));
+                prepared.imageBytes += image.sizeInBytes();
+            }
+        }
+        if (inlined) {
+            html.replace(placeholder, "\"" + url + "\"");
+        } else if (object.isImage()) {
+            html += QString("<p><img src=\"%1\"/></p>").arg(url);
+        } else {
+            html += QString(u8"<p>附件：<a href=\"%1\">%2</a></p>")
+                    .arg(url, QFileInfo(path).fileName().toHtmlEscaped());
+        }
+    }
+
+    return prepared;
+}
+
+// 构建文档：先登记已解码的图片资源，setHtml时不再从磁盘加载
+QTextDocument *ReqRenderCache::build(const PreparedDoc &prepared) {
+    QTextDocument *doc = new QTextDocument();
+    for (const auto &image : prepared.images) {
+        doc->addResource(QTextDocument::ImageResource, image.first, image.second);
+    }
+    doc->setHtml(prepared.html);
+    doc->setProperty("reqImageBytes", prepared.imageBytes);
+    return doc;
+}
+
+// 估算文档内存占用（文本及格式约16字节/字符，另加图片）
+int ReqRenderCache::costKb(const QTextDocument *doc) {
+    const qint64 bytes = qint64(doc->characterCount()) * 16 + doc->property("reqImageBytes").toLongLong();
+    return int(qMin<qint64>(bytes / 1024 + 1, INT_MAX));
+}
+
+// 启动排队的预渲染
+void ReqRenderCache::startPrefetch() {
+    if (m_queued.isEmpty()) return;
+
+    QList<RenderJob> jobs;
+    jobs.swap(m_queued);
+    ReqifParser *parser = m_parser;
+    m_runningGeneration = m_generation;
+    m_watcher.setFuture(QtConcurrent::run([parser, jobs]() {
+        RenderResults results;
+        foreach (const RenderJob &job, jobs) {
+            results.append(prepare(parser, job));
+        }
+        return results;
+    }));
+}
@@ -0,0 +1,66 @@
+﻿#ifndef REQRENDERCACHE_H
+#define REQRENDERCACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QFutureWatcher>
+#include <QImage>
+#include <QList>
+#include <QPair>
+#include <QStringList>
+#include <QTextDocument>
+#include <QUrl>
+#include "ReqifParser.h"
+
+// 需求描述渲染缓存：QTextDocument按估算内存计费的LRU缓存，后台线程为相邻需求准备HTML并解码图片，
+// QTextDocument只在主线程构建
+// 显示中的文档由调用方take()取走，切换时give()归还，避免被淘汰时删除
+class ReqRenderCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ReqRenderCache(ReqifParser *parser, QObject *parent = nullptr);
+    ~ReqRenderCache();
+
+    void setMaxCostKb(int kb);                           // 缓存上限（KB，默认64MB）
+    void setParser(ReqifParser *parser);                 // 切换渲染的文档（变化时清空缓存）
+    ReqifParser *parser() const;
+    QTextDocument *take(const QString &reqId);           // 取出渲染结果（未命中时同步渲染），调用方持有
+    void give(const QString &reqId, QTextDocument *doc); // 归还文档到缓存
+    void prefetch(const QStringList &reqIds);            // 后台预渲染（已缓存的跳过）
+    void clear();                                        // 清空缓存（重新加载后调用）
+
+private slots:
+    void onPrefetchFinished();                           // 预渲染完成，构建文档放入缓存
+
+private:
+    struct RenderJob {
+        QString reqId;
+        QString html;                                    // 富文本描述（为空时按纯文本渲染）
+        QString plainText;                               // 纯文本描述
+        QList<ReqEmbeddedObject> objects;                // 嵌入对象
+    };
+    struct PreparedDoc {
+        QString reqId;
+        QString html;                                    // 图片与附件已替换为本地文件链接
+        QList<QPair<QUrl, QImage>> images;               // 已解码的图片资源
+        qint64 imageBytes = 0;
+    };
+    typedef QList<PreparedDoc> RenderResults;
+
+    RenderJob makeJob(const QString &reqId) const;       // 在主线程收集渲染输入
+    static PreparedDoc prepare(ReqifParser *parser, const RenderJob &job); // 准备HTML与图片（可在后台线程执行）
+    static QTextDocument *build(const PreparedDoc &prepared); // 构建文档（仅主线程）
+    static int costKb(const QTextDocument *doc);         // 估算文档内存占用
+    void startPrefetch();                                // 启动排队的预渲染
+
+private:
+    ReqifParser *m_parser;
+    QCache<QString, QTextDocument> m_cache;              // LRU缓存（需求ID -> 文档）
+    QFutureWatcher<RenderResults> m_watcher;             // 后台预渲染
+    QList<RenderJob> m_queued;                           // 等待预渲染的任务（新请求覆盖旧请求）
+    int m_generation = 0;                                // clear()后递增，丢弃过期的预渲染结果
+    int m_runningGeneration = 0;
+};
+
+#endif // REQRENDERCACHE_H
@@ -0,0 +1,48 @@
+﻿#include "ReqStringPool.h"
+
+// 返回池中相同内容的字符串
+QString ReqStringPool::intern(const QString &text) {
+    if (text.isEmpty()) return QString();
+
+    Shard &shard = m_shards[qHash(text) % ShardCount];
+    QMutexLocker locker(&shard.mutex);
+    auto it = shard.strings.constFind(text);
+    if (it != shard.strings.constEnd()) return *it;
+    QString pooled = text;
+    pooled.squeeze(); // 拼接生成的字符串可能带有多余容量，入池前收紧
+    shard.strings.insert(pooled);
+    return pooled;
+}
+
+int ReqStringPool::size() const {
+    int count = 0;
+    for (const Shard &shard : m_shards) {
+        QMutexLocker locker(&shard.mutex);
+        count += shard.strings.size();
+    }
+    return count;
+}
+
+// 移除只被池引用的字符串（引用计数为1时isDetached()为真）
+int ReqStringPool::prune() {
+    int removed = 0;
+    for (Shard &shard : m_shards) {
+        QMutexLocker locker(&shard.mutex);
+        for (auto it = shard.strings.begin(); it != shard.strings.end();) {
+            if (it->isDetached()) {
+                it = shard.strings.erase(it);
+                ++removed;
+            } else {
+                ++it;
+            }
+        }
+    }
+    return removed;
+}
+
+void ReqStringPool::clear() {
+    for (Shard &shard : m_shards) {
+        QMutexLocker locker(&shard.mutex);
+        shard.strings.clear();
+    }
+}
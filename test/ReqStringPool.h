@@ -0,0 +1,27 @@
+﻿#ifndef REQSTRINGPOOL_H
+#define REQSTRINGPOOL_H
+
+#include <QString>
+#include <QSet>
+#include <QMutex>
+
+// 字符串驻留池：相同内容的字符串共享同一份数据（QString隐式共享）
+// 多个基线/文档共用时，ID、名称、描述等重复字符串只占一份内存；按哈希分片加锁，可被多个解析线程并发使用
+class ReqStringPool
+{
+public:
+    QString intern(const QString &text);                 // 返回池中相同内容的字符串（不存在时加入）
+    int size() const;                                    // 池中字符串数
+    int prune();                                         // 移除只被池引用的字符串（文档关闭/重新加载后调用），返回移除数
+    void clear();                                        // 清空（已取出的字符串不受影响）
+
+private:
+    enum { ShardCount = 16 };
+    struct Shard {
+        mutable QMutex mutex;
+        QSet<QString> strings;
+    };
+    Shard m_shards[ShardCount];
+};
+
+#endif // REQSTRINGPOOL_H
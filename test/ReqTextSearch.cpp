@@ -0,0 +1,219 @@
+﻿#include "ReqTextSearch.h"
+#include "ReqStringPool.h"
+#include <cstring>
+
+// x64总有SSE2；32位x86仅在编译器以SSE2为基线（MSVC /arch:SSE2，GCC -msse2）时启用，AVX2均按运行时检测
+#if defined(__x86_64__) || defined(_M_X64) || \
+    (defined(_M_IX86) && defined(_M_IX86_FP) && _M_IX86_FP >= 2) || (defined(__i386__) && defined(__SSE2__))
+#  define REQ_SIMD_X86 1
+#  include <immintrin.h>
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#    define REQ_TARGET_AVX2
+#  else
+#    define REQ_TARGET_AVX2 __attribute__((target("avx2")))
+#  endif
+#endif
+
+namespace {
+
+typedef int (*FindFn)(const ushort *, int, const ushort *, int);
+
+// 比较候选位置的剩余字符（首尾字符已由调用方确认）
+inline bool matchesAt(const ushort *candidate, const ushort *needle, int needleLength) {
+    return needleLength <= 2 ||
+           memcmp(candidate + 1, needle + 1, size_t(needleLength - 2) * sizeof(ushort)) == 0;
+}
+
+// 标量实现（兜底及SIMD尾部处理）
+int findScalar(const ushort *haystack, int length, const ushort *needle, int needleLength) {
+    const ushort first = needle[0];
+    const ushort last = needle[needleLength - 1];
+    for (int i = 0; i + needleLength <= length; ++i) {
+        if (haystack[i] == first && haystack[i + needleLength - 1] == last &&
+            matchesAt(haystack + i, needle, needleLength)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+#ifdef REQ_SIMD_X86
+inline int lowestBit(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return int(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// SSE2：每次比较8个字符的首字符与尾字符，仅对候选位置做完整比较
+int findSse2(const ushort *haystack, int length, const ushort *needle, int needleLength) {
+    const __m128i first = _mm_set1_epi16(short(needle[0]));
+    const __m128i last = _mm_set1_epi16(short(needle[needleLength - 1]));
+
+    int i = 0;
+    for (; i + needleLength - 1 + 8 <= length; i += 8) {
+        const __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i));
+        const __m128i blockLast = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(haystack + i + needleLength - 1));
+        const __m128i eq = _mm_and_si128(_mm_cmpeq_epi16(first, blockFirst),
+                                         _mm_cmpeq_epi16(last, blockLast));
+        unsigned mask = unsigned(_mm_movemask_epi8(eq));
+        while (mask) {
+            const int bit = lowestBit(mask);
+            const int pos = i + bit / 2;
+            if (matchesAt(haystack + pos, needle, needleLength)) return pos;
+            mask &= ~(3u << bit);                        // 每个字符占2位
+        }
+    }
+    const int tail = findScalar(haystack + i, length - i, needle, needleLength);
+    return tail < 0 ? -1 : i + tail;
+}
+
+// AVX2：同上，每次处理16个字符
+REQ_TARGET_AVX2
+int findAvx2(const ushort *haystack, int length, const ushort *needle, int needleLength) {
+    const __m256i first = _mm256_set1_epi16(short(needle[0]));
+    const __m256i last = _mm256_set1_epi16(short(needle[needleLength - 1]));
+
+    int i = 0;
+    for (; i + needleLength - 1 + 16 <= length; i += 16) {
+        const __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i));
+        const __m256i blockLast = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(haystack + i + needleLength - 1));
+        const __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi16(first, blockFirst),
+                                            _mm256_cmpeq_epi16(last, blockLast));
+        unsigned mask = unsigned(_mm256_movemask_epi8(eq));
+        while (mask) {
+            const int bit = lowestBit(mask);
+            const int pos = i + bit / 2;
+            if (matchesAt(haystack + pos, needle, needleLength)) return pos;
+            mask &= ~(3u << bit);
+        }
+    }
+    const int tail = findScalar(haystack + i, length - i, needle, needleLength);
+    return tail < 0 ? -1 : i + tail;
+}
+
+bool cpuHasAvx2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif // REQ_SIMD_X86
+
+FindFn selectFind() {
+#ifdef REQ_SIMD_X86
+    return cpuHasAvx2() ? findAvx2 : findSse2;
+#else
+    return findScalar;
+#endif
+}
+
+} // namespace
+
+int reqFindFolded(const ushort *haystack, int length, const ushort *needle, int needleLength) {
+    static const FindFn find = selectFind();             // 仅检测一次CPU能力
+    if (needleLength <= 0) return 0;
+    if (needleLength > length) return -1;
+    return find(haystack, length, needle, needleLength);
+}
+
+void ReqTextSearch::setStringPool(ReqStringPool *pool) {
+    m_pool = pool;
+}
+
+void ReqTextSearch::clear() {
+    m_ids.clear();
+    m_names = FieldIndex();
+    m_descriptions = FieldIndex();
+}
+
+void ReqTextSearch::reserve(int count) {
+    m_ids.reserve(count);
+    m_names.handles.reserve(count);
+    m_descriptions.handles.reserve(count);
+}
+
+ReqTextSearch::Handle ReqTextSearch::add(const QString &id, const QString &name, const QString &description) {
+    m_ids.append(id);
+    addText(m_names, name);
+    addText(m_descriptions, description);
+    return m_ids.size() - 1;
+}
+
+int ReqTextSearch::size() const {
+    return m_ids.size();
+}
+
+QString ReqTextSearch::idAt(Handle handle) const {
+    return m_ids.value(handle);
+}
+
+// ID与需求存储共享数据，只计列表本身；经驻留池共享的折叠文本按引用计入（上限估计）
+qint64 ReqTextSearch::memoryBytes() const {
+    return fieldBytes(m_names) + fieldBytes(m_descriptions) + qint64(m_ids.size()) * int(sizeof(void *));
+}
+
+QVector<ReqTextSearch::Handle> ReqTextSearch::find(const QString &text, int fields) const {
+    QVector<Handle> hits;
+    const QString needle = text.toCaseFolded();
+    if (needle.isEmpty()) return hits;
+
+    // 先按去重后的文本扫描，再映射到句柄（结果按句柄升序，每个需求最多一次）
+    const QVector<bool> nameHits = (fields & NameField) ? scanField(m_names, needle) : QVector<bool>();
+    const QVector<bool> descHits = (fields & DescriptionField) ? scanField(m_descriptions, needle) : QVector<bool>();
+    for (Handle handle = 0; handle < m_ids.size(); ++handle) {
+        if ((!nameHits.isEmpty() && nameHits.at(m_names.handles.at(handle))) ||
+            (!descHits.isEmpty() && descHits.at(m_descriptions.handles.at(handle)))) {
+            hits.append(handle);
+        }
+    }
+    return hits;
+}
+
+// 追加字段文本：相同原文只折叠一次，折叠结果经驻留池共享
+void ReqTextSearch::addText(FieldIndex &field, const QString &text) {
+    auto it = field.lookup.constFind(text);
+    if (it == field.lookup.constEnd()) {
+        const QString folded = text.toCaseFolded();
+        field.texts.append(m_pool ? m_pool->intern(folded) : folded);
+        it = field.lookup.insert(text, field.texts.size() - 1);
+    }
+    field.handles.append(it.value());
+}
+
+// 扫描字段中的每个折叠文本
+QVector<bool> ReqTextSearch::scanField(const FieldIndex &field, const QString &needle) {
+    QVector<bool> hits(field.texts.size(), false);
+    for (int i = 0; i < field.texts.size(); ++i) {
+        const QString &text = field.texts.at(i);
+        hits[i] = reqFindFolded(text.utf16(), text.size(), needle.utf16(), needle.size()) >= 0;
+    }
+    return hits;
+}
+
+// 折叠文本、查找表节点与句柄数组
+qint64 ReqTextSearch::fieldBytes(const FieldIndex &field) {
+    qint64 bytes = qint64(field.handles.capacity()) * int(sizeof(int))
+                 + qint64(field.texts.capacity()) * int(sizeof(QString))
+                 + qint64(field.lookup.size()) * int(sizeof(void *) * 2 + sizeof(QString) + sizeof(int));
+    for (const QString &text : field.texts) {
+        bytes += qint64(text.capacity()) * int(sizeof(QChar));
+    }
+    return bytes;
+}
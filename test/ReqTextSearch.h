@@ -0,0 +1,56 @@
+﻿#ifndef REQTEXTSEARCH_H
+#define REQTEXTSEARCH_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+
+class ReqStringPool;
+
+// 在已折叠大小写的UTF-16文本中查找子串，返回首个匹配位置（未找到返回-1）
+// 运行时按CPU能力选择AVX2/SSE2实现，其余平台使用标量实现
+int reqFindFolded(const ushort *haystack, int length, const ushort *needle, int needleLength);
+
+// 需求文本检索索引：加载时一次性折叠大小写，检索时逐个扫描折叠文本
+// 折叠文本按原文去重，设置驻留池时经池共享，多个文档/基线中相同的名称与描述只保存一份
+class ReqTextSearch
+{
+public:
+    typedef int Handle;                                  // 需求句柄（索引内序号）
+
+    enum Field {
+        NameField        = 0x1,                          // 检索名称
+        DescriptionField = 0x2                           // 检索描述
+    };
+
+    void setStringPool(ReqStringPool *pool);             // 折叠文本的驻留池（不持有，可为空）
+    void clear();                                        // 清空索引
+    void reserve(int count);                             // 预分配需求数量
+    Handle add(const QString &id, const QString &name, const QString &description); // 添加需求
+    int size() const;                                    // 已索引需求数
+    QString idAt(Handle handle) const;                   // 句柄 -> 需求ID
+    qint64 memoryBytes() const;                          // 索引占用内存（字节，按已分配容量）
+
+    QVector<Handle> find(const QString &text, int fields = NameField) const; // 不区分大小写检索
+
+private:
+    // 单个检索字段：各需求引用去重后的折叠文本
+    struct FieldIndex {
+        QVector<QString> texts;                          // 去重后的折叠文本
+        QHash<QString, int> lookup;                      // 原文 -> texts下标（键与需求存储共享数据）
+        QVector<int> handles;                            // 句柄 -> texts下标
+    };
+
+    void addText(FieldIndex &field, const QString &text); // 追加一个需求的字段文本
+    static QVector<bool> scanField(const FieldIndex &field, const QString &needle); // 各折叠文本是否命中
+    static qint64 fieldBytes(const FieldIndex &field);
+
+private:
+    ReqStringPool *m_pool = nullptr;
+    QStringList m_ids;                                   // 句柄 -> 需求ID
+    FieldIndex m_names;                                  // 名称
+    FieldIndex m_descriptions;                           // 描述
+};
+
+#endif // REQTEXTSEARCH_H
@@ -0,0 +1,347 @@
+﻿#include "ReqWorkspace.h"
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <QSet>
+#include <QtConcurrent>
+
+namespace {
+
+// 单个文件的加载任务
+struct LoadJob {
+    QString filePath;
+    ReqifParser *parser = nullptr;
+    bool ok = false;
+};
+
+} // namespace
+
+ReqWorkspace::ReqWorkspace(QObject *parent) : QObject(parent)
+{
+}
+
+ReqWorkspace::~ReqWorkspace() {
+    qDeleteAll(m_docs);
+}
+
+// 并行加载：解析器在主线程创建，load()在线程池中执行，完成后再启用监视、连接信号
+int ReqWorkspace::open(const QStringList &filePaths) {
+    m_errors.clear();
+
+    // 内存预算按打开后的文档数平分
+    QSet<QString> allPaths = QSet<QString>::fromList(this->filePaths());
+    foreach (const QString &filePath, filePaths) {
+        allPaths.insert(canonicalPath(filePath));
+    }
+    const qint64 budgetShare = m_memoryBudget / qMax(1, allPaths.size());
+
+    QList<LoadJob> jobs;
+    foreach (const QString &filePath, filePaths) {
+        LoadJob job;
+        job.filePath = canonicalPath(filePath);
+        job.parser = new ReqifParser();
+        job.parser->setInteractive(false); // 工作线程中不能弹窗
+        job.parser->setKeepRichText(m_keepRichText);
+        job.parser->setLazyLoading(m_lazyLoading);
+        job.parser->setOutOfCore(m_outOfCore);
+        job.parser->setHierarchyRule(m_hierarchyRule);
+        job.parser->setMemoryBudget(budgetShare);
+        job.parser->setStringPool(&m_stringPool);
+        jobs.append(job);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QtConcurrent::blockingMap(jobs, [](LoadJob &job) {
+        job.ok = job.parser->load(job.filePath);
+    });
+
+    int loaded = 0;
+    for (LoadJob &job : jobs) {
+        if (!job.ok) {
+            const QString error = job.parser->errorString().isEmpty() ? QString(u8"文件中没有有效需求")
+                                                                      : job.parser->errorString();
+            m_errors.append(QString(u8"%1：%2").arg(QFileInfo(job.filePath).fileName(), error));
+            delete job.parser;
+            continue;
+        }
+
+        // 同一文件再次打开时替换旧文档，保持原有顺序
+        ReqifParser *parser = job.parser;
+        const int index = m_docs.indexOf(document(job.filePath));
+        if (index >= 0) {
+            delete m_docs.at(index);
+            m_docs[index] = parser;
+            m_stringPool.prune();
+        } else {
+            m_docs.append(parser);
+        }
+        parser->setAutoReload(true);
+        connect(parser, &ReqifParser::reqsChanged, this, [this, parser](const ReqChangeSet &changes) {
+            emit reqsChanged(parser, changes);
+        });
+        connect(parser, &ReqifParser::reloadFailed, this, [this, parser](const QString &error) {
+            emit reloadFailed(parser, error);
+        });
+        ++loaded;
+    }
+
+    qDebug() << u8"工作区加载完成 | 文件：" << loaded << "/" << jobs.size()
+             << u8"耗时(ms)：" << timer.elapsed() << u8"驻留字符串：" << m_stringPool.size();
+    return loaded;
+}
+
+// 关闭文档
+void ReqWorkspace::close(const QString &filePath) {
+    ReqifParser *parser = document(filePath);
+    if (!parser) return;
+    m_docs.removeOne(parser);
+    delete parser;
+    if (m_docs.isEmpty()) {
+        m_stringPool.clear();
+    } else {
+        m_stringPool.prune();
+    }
+}
+
+// 关闭全部文档并清空驻留池
+void ReqWorkspace::clear() {
+    qDeleteAll(m_docs);
+    m_docs.clear();
+    m_stringPool.clear();
+}
+
+void ReqWorkspace::setKeepRichText(bool keep) {
+    m_keepRichText = keep;
+    foreach (ReqifParser *parser, m_docs) {
+        parser->setKeepRichText(keep);
+    }
+}
+
+void ReqWorkspace::setLazyLoading(bool lazy) {
+    m_lazyLoading = lazy;
+    foreach (ReqifParser *parser, m_docs) {
+        parser->setLazyLoading(lazy);
+    }
+}
+
+bool ReqWorkspace::lazyLoading() const {
+    return m_lazyLoading;
+}
+
+void ReqWorkspace::setOutOfCore(bool enabled) {
+    m_outOfCore = enabled;
+    foreach (ReqifParser *parser, m_docs) {
+        parser->setOutOfCore(enabled);
+    }
+}
+
+bool ReqWorkspace::outOfCore() const {
+    return m_outOfCore;
+}
+
+void ReqWorkspace::setHierarchyRule(ReqifParser::HierarchyRule rule) {
+    m_hierarchyRule = rule;
+    foreach (ReqifParser *parser, m_docs) {
+        parser->setHierarchyRule(rule);
+    }
+}
+
+// 内存预算（全部文档合计，0为不限）：加载时按文档数平分，下次加载生效
+void ReqWorkspace::setMemoryBudget(qint64 bytes) {
+    m_memoryBudget = qMax<qint64>(0, bytes);
+}
+
+qint64 ReqWorkspace::memoryBudget() const {
+    return m_memoryBudget;
+}
+
+// 全部文档的内存占用估算（不含需求树）
+ReqMemoryUsage ReqWorkspace::memoryUsage() const {
+    ReqMemoryUsage usage;
+    foreach (ReqifParser *parser, m_docs) {
+        usage.add(parser->memoryUsage());
+    }
+    return usage;
+}
+
+// 描述已改为按需读取的文档数
+int ReqWorkspace::offloadedCount() const {
+    int count = 0;
+    foreach (ReqifParser *parser, m_docs) {
+        if (parser->descriptionsOffloaded()) ++count;
+    }
+    return count;
+}
+
+// 全部文档的完整性诊断数
+int ReqWorkspace::diagnosticCount() const {
+    int count = 0;
+    foreach (ReqifParser *parser, m_docs) {
+        count += parser->diagnosticCount();
+    }
+    return count;
+}
+
+QList<ReqifParser*> ReqWorkspace::documents() const {
+    return m_docs;
+}
+
+QStringList ReqWorkspace::filePaths() const {
+    QStringList paths;
+    foreach (ReqifParser *parser, m_docs) {
+        paths.append(parser->filePath());
+    }
+    return paths;
+}
+
+// 按路径查找文档
+ReqifParser *ReqWorkspace::document(const QString &filePath) const {
+    const QString path = canonicalPath(filePath);
+    foreach (ReqifParser *parser, m_docs) {
+        if (parser->filePath() == path) return parser;
+    }
+    return nullptr;
+}
+
+// 需求树节点所属文档（沿父节点找到文档根节点）
+ReqifParser *ReqWorkspace::documentForItem(QTreeWidgetItem *item) const {
+    while (item && item->parent()) {
+        item = item->parent();
+    }
+    return item ? document(item->data(0, DocumentRole).toString()) : nullptr;
+}
+
+// 包含该需求ID的文档（同一需求可能出现在多个基线中）
+QList<ReqifParser*> ReqWorkspace::documentsContaining(const QString &reqId) const {
+    QList<ReqifParser*> result;
+    ReqData req;
+    foreach (ReqifParser *parser, m_docs) {
+        if (parser->getReq(reqId, req)) result.append(parser);
+    }
+    return result;
+}
+
+// 跨文档按ID查找
+ReqifParser *ReqWorkspace::findReq(const QString &reqId, ReqData &req) const {
+    foreach (ReqifParser *parser, m_docs) {
+        if (parser->getReq(reqId, req)) return parser;
+    }
+    return nullptr;
+}
+
+int ReqWorkspace::reqCount() const {
+    int count = 0;
+    foreach (ReqifParser *parser, m_docs) {
+        count += parser->getAllReqCount();
+    }
+    return count;
+}
+
+int ReqWorkspace::validReqCount() const {
+    int count = 0;
+    foreach (ReqifParser *parser, m_docs) {
+        count += parser->getValidReqCount();
+    }
+    return count;
+}
+
+const ReqStringPool &ReqWorkspace::stringPool() const {
+    return m_stringPool;
+}
+
+QStringList ReqWorkspace::errors() const {
+    return m_errors;
+}
+
+// 填充需求树（每个文档一个根节点）
+void ReqWorkspace::fillTree(QTreeWidget *treeWidget) {
+    if (!treeWidget) return;
+
+    treeWidget->clear();
+    treeWidget->setHeaderLabels(QStringList() << u8"序号" << u8"需求名称");
+    treeWidget->setSortingEnabled(false);
+    treeWidget->setIndentation(20);
+
+    foreach (ReqifParser *parser, m_docs) {
+        parser->fillTreeItems(createDocumentItem(treeWidget, parser));
+    }
+
+    treeWidget->expandAll();
+    collapseUnloadedItems(treeWidget);
+    treeWidget->resizeColumnToContents(0);
+    treeWidget->resizeColumnToContents(1);
+}
+
+// 按关键词过滤填充（无匹配的文档不显示）
+int ReqWorkspace::fillTreeWithFilter(QTreeWidget *treeWidget, const QString &filterText) {
+    if (!treeWidget) return 0;
+    if (filterText.isEmpty()) {
+        fillTree(treeWidget);
+        return reqCount();
+    }
+
+    treeWidget->clear();
+    treeWidget->setHeaderLabels(QStringList() << u8"序号" << u8"需求名称");
+    treeWidget->setSortingEnabled(false);
+    treeWidget->setIndentation(20);
+
+    int totalCount = 0;
+    foreach (ReqifParser *parser, m_docs) {
+        QTreeWidgetItem *docItem = createDocumentItem(treeWidget, parser);
+        const int count = parser->fillTreeItemsWithFilter(docItem, filterText);
+        if (count == 0) {
+            delete docItem;
+        }
+        totalCount += count;
+    }
+
+    treeWidget->expandAll();
+    collapseUnloadedItems(treeWidget);
+    treeWidget->resizeColumnToContents(0);
+    treeWidget->resizeColumnToContents(1);
+    return totalCount;
+}
+
+// 文档根节点
+QTreeWidgetItem *ReqWorkspace::documentItem(QTreeWidget *treeWidget, ReqifParser *document) const {
+    if (!treeWidget || !document) return nullptr;
+    for (int i = 0; i < treeWidget->topLevelItemCount(); ++i) {
+        QTreeWidgetItem *item = treeWidget->topLevelItem(i);
+        if (item->data(0, DocumentRole).toString() == document->filePath()) return item;
+    }
+    return nullptr;
+}
+
+// 创建文档根节点（不带需求ID，点击时不显示描述）
+QTreeWidgetItem *ReqWorkspace::createDocumentItem(QTreeWidget *treeWidget, ReqifParser *document) const {
+    QTreeWidgetItem *item = new QTreeWidgetItem(treeWidget);
+    item->setText(1, QFileInfo(document->filePath()).fileName());
+    item->setToolTip(1, document->filePath());
+    item->setData(0, DocumentRole, document->filePath());
+    QFont font = item->font(1);
+    font.setBold(true);
+    item->setFont(1, font);
+    return item;
+}
+
+// 未加载的规格与超大文件模式的索引节点保持折叠（expandAll不逐项发出itemExpanded，需显式收起，用户展开时再加载）
+void ReqWorkspace::collapseUnloadedItems(QTreeWidget *treeWidget) {
+    for (int i = 0; i < treeWidget->topLevelItemCount(); ++i) {
+        QTreeWidgetItem *docItem = treeWidget->topLevelItem(i);
+        for (int j = 0; j < docItem->childCount(); ++j) {
+            QTreeWidgetItem *item = docItem->child(j);
+            const bool unloaded = !item->data(0, ReqifParser::SpecificationRole).isNull() ||
+                                  !item->data(0, ReqifParser::IndexRecordRole).isNull();
+            if (unloaded && item->childCount() == 0) {
+                item->setExpanded(false);
+            }
+        }
+    }
+}
+
+// 统一文档路径（同一文件的不同写法视为同一文档）
+QString ReqWorkspace::canonicalPath(const QString &filePath) {
+    const QString canonical = QFileInfo(filePath).canonicalFilePath();
+    return canonical.isEmpty() ? QFileInfo(filePath).absoluteFilePath() : canonical;
+}
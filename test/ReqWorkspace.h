@@ -0,0 +1,72 @@
+﻿#ifndef REQWORKSPACE_H
+#define REQWORKSPACE_H
+
+#include <QObject>
+#include <QList>
+#include <QStringList>
+#include <QTreeWidget>
+#include "ReqifParser.h"
+#include "ReqStringPool.h"
+
+// 多文档工作区：并行加载多个ReqIF文件（每个文件一个工作线程），共享字符串驻留池
+// 需求树中每个文档一个根节点；需求ID可跨文档查找
+class ReqWorkspace : public QObject
+{
+    Q_OBJECT
+public:
+    enum { DocumentRole = Qt::UserRole + 1 };            // 文档根节点上保存文件路径的数据角色
+
+    explicit ReqWorkspace(QObject *parent = nullptr);
+    ~ReqWorkspace();
+
+    int open(const QStringList &filePaths);              // 并行加载（已打开的文件重新加载），返回成功数
+    void close(const QString &filePath);                 // 关闭文档
+    void clear();                                        // 关闭全部文档并清空驻留池
+    void setKeepRichText(bool keep);                     // 解析时是否保留富文本描述（下次加载生效）
+    void setLazyLoading(bool lazy);                      // 按规格延迟加载（下次加载生效）
+    bool lazyLoading() const;
+    void setHierarchyRule(ReqifParser::HierarchyRule rule); // 层次推断规则（下次加载生效）
+    void setOutOfCore(bool enabled);                     // 超大文件模式（磁盘索引，下次加载生效）
+    bool outOfCore() const;
+    void setMemoryBudget(qint64 bytes);                  // 内存预算（字节，全部文档合计，0为不限，下次加载生效）
+    qint64 memoryBudget() const;
+
+    QList<ReqifParser*> documents() const;               // 已加载的文档（按打开顺序）
+    QStringList filePaths() const;                       // 已加载的文件路径
+    ReqifParser *document(const QString &filePath) const; // 按路径查找文档
+    ReqifParser *documentForItem(QTreeWidgetItem *item) const; // 需求树节点所属文档
+    QList<ReqifParser*> documentsContaining(const QString &reqId) const; // 包含该需求ID的文档
+    ReqifParser *findReq(const QString &reqId, ReqData &req) const; // 跨文档按ID查找（返回首个包含的文档）
+    int reqCount() const;                                // 全部文档的需求总数
+    int validReqCount() const;                           // 全部文档的有效需求数
+    ReqMemoryUsage memoryUsage() const;                  // 全部文档的内存占用估算（不含需求树）
+    int offloadedCount() const;                          // 超出预算、描述改为按需读取的文档数
+    int diagnosticCount() const;                         // 全部文档的完整性诊断数
+    const ReqStringPool &stringPool() const;
+    QStringList errors() const;                          // 最近一次open失败的文件及原因
+
+    void fillTree(QTreeWidget *treeWidget);              // 填充需求树（每个文档一个根节点）
+    int fillTreeWithFilter(QTreeWidget *treeWidget, const QString &filterText); // 按关键词过滤填充，返回匹配数
+    QTreeWidgetItem *documentItem(QTreeWidget *treeWidget, ReqifParser *document) const; // 文档根节点
+
+signals:
+    void reqsChanged(ReqifParser *document, const ReqChangeSet &changes); // 文档增量重新加载后的差异
+    void reloadFailed(ReqifParser *document, const QString &error);       // 文档自动重新加载失败
+
+private:
+    QTreeWidgetItem *createDocumentItem(QTreeWidget *treeWidget, ReqifParser *document) const; // 创建文档根节点
+    static void collapseUnloadedItems(QTreeWidget *treeWidget); // 未加载的规格与索引节点保持折叠，展开时再加载
+    static QString canonicalPath(const QString &filePath); // 统一文档路径
+
+private:
+    QList<ReqifParser*> m_docs;                          // 已加载的文档（按打开顺序）
+    ReqStringPool m_stringPool;                          // 文档间共享的字符串驻留池
+    bool m_keepRichText = false;                         // 是否保留富文本描述
+    bool m_lazyLoading = false;                          // 是否按规格延迟加载
+    bool m_outOfCore = false;                            // 是否使用超大文件模式
+    ReqifParser::HierarchyRule m_hierarchyRule = ReqifParser::InferAuto; // 层次推断规则
+    qint64 m_memoryBudget = 0;                           // 内存预算（字节，0为不限）
+    QStringList m_errors;                                // 最近一次open失败的文件及原因
+};
+
+#endif // REQWORKSPACE_H
@@ -1,24 +1,356 @@
 ﻿#include "ReqifParser.h"
+#include "ReqRecordWriter.h"
+#include "ReqStringPool.h"
+#include "ReqHierarchyInference.h"
+#include "ReqDiskIndex.h"
 #include <QFile>
 #include <QXmlStreamReader>
 #include <QDebug>
 #include <QRegExp>
 #include <algorithm>
 #include <QXmlStreamNamespaceDeclaration>
+#include <QFileSystemWatcher>
+#include <QFileInfo>
+#include <QTimer>
+#include <QCryptographicHash>
+#include <QBuffer>
+#include <QTextCodec>
+#include <QtConcurrent>
+#include <QThread>
+#include <QElapsedTimer>
+#include <utility>
+
+namespace {
+
+const int PendingBatchSize = 4096;                // 每批后处理的需求数
+const qint64 PendingBatchChars = 4 * 1024 * 1024; // 每批原始XHTML字符数上限（约8MB）
+
+// 按toHtmlEscaped的规则转义并追加，不生成临时字符串
+void appendEscaped(QString &out, const QStringRef &text) {
+    const QChar *plain = text.constData();
+    const QChar *end = plain + text.size();
+    for (const QChar *p = plain; p != end; ++p) {
+        const char *entity = nullptr;
+        switch (p->unicode()) {
+        case '<': entity = "&lt;"; break;
+        case '>': entity = "&gt;"; break;
+        case '&': entity = "&amp;"; break;
+        case '"': entity = "&quot;"; break;
+        default: continue;
+        }
+        out.append(plain, int(p - plain));
+        out += QLatin1String(entity);
+        plain = p + 1;
+    }
+    out.append(plain, int(end - plain));
+}
+
+} // namespace
 
 // 构造函数
 ReqifParser::ReqifParser(QObject *parent) : QObject(parent)
 {
 }
 
+ReqifParser::~ReqifParser() {
+    releaseDataAsync();
+    delete m_diskIndex;
+}
+
+// 需求存储移交后台线程释放：百万级需求逐个析构较慢，不阻塞重新加载和关闭
+void ReqifParser::releaseDataAsync() {
+    if (m_reqMap.isEmpty()) return;
+
+    struct Released {
+        QMap<QString, ReqData> reqMap;
+        QMap<QString, QString> parentMap;
+        QMap<QString, QStringList> childMap;
+        QList<QString> topReqIds;
+        QHash<QString, QByteArray> fingerprints;
+    };
+    Released *released = new Released;
+    released->reqMap.swap(m_reqMap);
+    released->parentMap.swap(m_parentMap);
+    released->childMap.swap(m_childMap);
+    released->topReqIds.swap(m_topReqIds);
+    released->fingerprints.swap(m_fingerprints);
+    QtConcurrent::run([released]() { delete released; });
+}
+
 // 加载ReqIF文件入口
 bool ReqifParser::load(const QString &filePath) {
     // 清空历史数据，避免残留
+    releaseDataAsync();
+    delete m_diskIndex;
+    m_diskIndex = nullptr;
     m_reqMap.clear();
     m_parentMap.clear();
     m_topReqIds.clear();
+    m_childMap.clear();
+    m_specs.clear();
+    m_currentSpec = -1;
+    m_specRanges.clear();
+    m_specObjectRanges.clear();
+    m_specLines.clear();
+    m_specObjectLines.clear();
+    m_reqifNamespace.clear();
+    m_namespaceDecls.clear();
+    m_objectScopeDecls.clear();
+    m_specScopeDecls.clear();
+    m_textIndex.clear();
+    m_errorString.clear();
+    m_fingerprints.clear();
+    m_stats = ReqStatistics();
+    m_diagnostics.clear();
+    m_diagnosticTotal = 0;
+    m_descriptionsOffloaded = false;
+    m_lastOffloaded = ReqData();
+    m_offloadRaw.close();
+    m_objectStore.reset(filePath);
+    if (m_watcher && !m_filePath.isEmpty()) {
+        m_watcher->removePath(m_filePath);
+    }
+    m_filePath = filePath;
+    if (m_watcher) {
+        m_watcher->addPath(filePath);
+    }
+    // 字节区间（延迟加载、描述按需读取）只对本次解析的文件版本有效
+    const QFileInfo info(filePath);
+    m_indexedSize = info.size();
+    m_indexedTime = info.lastModified();
+    if (m_outOfCore) return loadOutOfCore(filePath);
+    return m_lazyLoading ? indexSpecifications(filePath) : parseXml(filePath);
+}
+
+// 增量重新加载：与上次加载的指纹比较，仅应用新增/删除/变化的需求和层次关系
+bool ReqifParser::reload() {
+    if (m_filePath.isEmpty()) return false;
+    if (m_diskIndex) {
+        m_errorString = u8"超大文件模式不支持增量重新加载，请重新打开";
+        return false;
+    }
+
+    ReqifParser fresh;
+    fresh.setInteractive(false);
+    fresh.setKeepRichText(m_keepRichText);
+    fresh.setStringPool(m_stringPool);
+    fresh.setLazyLoading(m_lazyLoading);
+    fresh.setHierarchyRule(m_hierarchyRule);
+    fresh.setOutlineAttribute(m_outlineAttribute);
+    fresh.setMemoryBudget(m_memoryBudget);
+    fresh.setStrict(m_strict);
+    if (!fresh.load(m_filePath)) {
+        m_errorString = fresh.errorString().isEmpty() ? QString(u8"文件中没有有效需求") : fresh.errorString();
+        return false;
+    }
+    // 延迟加载时只比较已打开的规格
+    for (const auto &spec : m_specs) {
+        if (m_lazyLoading && spec.loaded && !fresh.loadSpecification(spec.id)) {
+            m_errorString = fresh.errorString();
+            return false;
+        }
+    }
+
+    // 1. 补齐上次加载的指纹（首次重新加载时计算）
+    if (m_fingerprints.isEmpty()) {
+        for (const auto &req : m_reqMap) {
+            m_fingerprints.insert(req.id, reqFingerprint(req));
+        }
+    }
+
+    // 2. 比较差异
+    ReqChangeSet changes;
+    QHash<QString, QByteArray> fingerprints;
+    fingerprints.reserve(fresh.m_reqMap.size());
+    for (const auto &req : fresh.m_reqMap) {
+        // 描述已卸载时使用卸载前记录的指纹
+        const QByteArray fingerprint = fresh.m_fingerprints.contains(req.id) ? fresh.m_fingerprints.value(req.id)
+                                                                             : reqFingerprint(req);
+        fingerprints.insert(req.id, fingerprint);
+
+        auto oldIt = m_reqMap.find(req.id);
+        if (oldIt == m_reqMap.end()) {
+            changes.added.append(req.id);
+            m_reqMap.insert(req.id, req);
+            continue;
+        }
+        if (m_fingerprints.value(req.id) != fingerprint) {
+            changes.changed.append(req.id);
+        }
+        if (oldIt->parentId != req.parentId) {
+            changes.moved.append(req.id);
+        }
+        if (oldIt->parentId != req.parentId || oldIt->level != req.level ||
+            m_fingerprints.value(req.id) != fingerprint) {
+            *oldIt = req;
+        }
+    }
+    for (auto it = m_reqMap.begin(); it != m_reqMap.end();) {
+        if (!fresh.m_reqMap.contains(it.key())) {
+            changes.removed.append(it.key());
+            it = m_reqMap.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // 3. 更新派生索引（合并后需求集合与fresh一致，统计直接沿用）
+    m_fingerprints.swap(fingerprints);
+    m_stats = fresh.m_stats;
+    m_diagnostics.swap(fresh.m_diagnostics);
+    m_diagnosticTotal = fresh.m_diagnosticTotal;
+    m_specs.swap(fresh.m_specs);
+    m_specRanges.swap(fresh.m_specRanges);
+    m_specObjectRanges.swap(fresh.m_specObjectRanges);
+    m_specLines.swap(fresh.m_specLines);
+    m_specObjectLines.swap(fresh.m_specObjectLines);
+    m_objectScopeDecls.swap(fresh.m_objectScopeDecls);
+    m_specScopeDecls.swap(fresh.m_specScopeDecls);
+    m_indexedSize = fresh.m_indexedSize;
+    m_indexedTime = fresh.m_indexedTime;
+    m_lastOffloaded = ReqData();
+    // 指纹不含对象字节（data已替换为reqobj:序号），图片单独变化或原地重写时需求集合可能不变，
+    // 因此每次成功重新加载都接管对象索引，旧映射、字节区间与提取记录一并作废
+    m_objectStore.takeIndex(fresh.m_objectStore);
+    if (m_descriptionsOffloaded || fresh.m_descriptionsOffloaded) {
+        offloadDescriptions(); // 未变化的旧记录与新记录统一改为按需读取
+    }
+    if (!changes.isEmpty()) {
+        m_parentMap.swap(fresh.m_parentMap);
+        m_topReqIds.swap(fresh.m_topReqIds);
+        m_childMap.swap(fresh.m_childMap);
+        buildTextIndex();
+        if (m_stringPool) {
+            m_stringPool->prune(); // 被替换的旧字符串只剩池中引用
+        }
+        qDebug() << u8"增量重新加载 | 新增：" << changes.added.size() << u8"删除：" << changes.removed.size()
+                 << u8"变化：" << changes.changed.size() << u8"移动：" << changes.moved.size();
+        emit reqsChanged(changes);
+    }
+    return true;
+}
+
+// 边解析边导出：SPEC-OBJECT解析完即写出，不保留需求数据
+// 对象先于层次出现，层次字段未知，level/parentId/path输出为空
+bool ReqifParser::streamTo(const QString &filePath, ReqRecordWriter &writer) {
     m_reqifNamespace.clear();
-    return parseXml(filePath);
+    m_errorString.clear();
+    m_sink = &writer;
+    writer.setHierarchyKnown(false);
+    writer.begin();
+    const bool ok = parseXml(filePath);
+    m_sink = nullptr;
+    if (!writer.finish() && ok) {
+        m_errorString = writer.errorString();
+        return false;
+    }
+    return ok;
+}
+
+// 导出已加载的全部需求（按ID顺序遍历，路径沿父链即时计算，不额外缓存）
+bool ReqifParser::writeRecords(ReqRecordWriter &writer) const {
+    writer.begin();
+    if (m_diskIndex) {
+        // 超大文件模式按文档顺序逐条读出
+        for (int i = 0; i < m_diskIndex->recordCount(); ++i) {
+            if (!m_diskIndex->isLive(i)) continue;
+            ReqData req = m_diskIndex->record(i);
+            req.description = m_diskIndex->description(i);
+            req.richDescription = m_diskIndex->richDescription(i);
+            if (!writer.write(req, getReqPath(req.id))) return false;
+        }
+        return writer.finish();
+    }
+    for (const auto &req : m_reqMap) {
+        if (m_descriptionsOffloaded) {
+            ReqData full = req;
+            if (!readOffloadedText(full)) {
+                writer.fail(QString(u8"无法读回需求 %1 的描述，源文件可能已变化").arg(req.id));
+                return false;
+            }
+            if (!writer.write(full, getReqPath(req.id))) return false;
+            continue;
+        }
+        if (!writer.write(req, getReqPath(req.id))) return false;
+    }
+    return writer.finish();
+}
+
+// 需求描述中的嵌入对象
+QList<ReqEmbeddedObject> ReqifParser::getReqObjects(const QString &reqId) const {
+    return m_objectStore.objects(reqId);
+}
+
+// 按需提取嵌入对象到缓存目录
+QString ReqifParser::extractObject(const ReqEmbeddedObject &object) {
+    return m_objectStore.extract(object);
+}
+
+// 嵌入对象存储
+ReqObjectStore &ReqifParser::objectStore() {
+    return m_objectStore;
+}
+
+// 需求路径（根到自身的ID，以'/'分隔）
+QString ReqifParser::getReqPath(const QString &reqId) const {
+    QStringList chain;
+    if (m_diskIndex) {
+        const int index = m_diskIndex->find(reqId);
+        if (index == ReqDiskIndex::NoRecord) return reqId;
+        for (int i = index; i >= 0 && chain.size() <= m_diskIndex->recordCount(); i = m_diskIndex->parent(i)) {
+            chain.prepend(m_diskIndex->id(i));
+        }
+        return chain.join('/');
+    }
+    QString currentId = reqId;
+    while (!currentId.isEmpty() && chain.size() <= m_reqMap.size()) { // 长度上限防循环
+        chain.prepend(currentId);
+        auto it = m_reqMap.constFind(currentId);
+        currentId = it == m_reqMap.constEnd() ? QString() : it->parentId;
+    }
+    return chain.join('/');
+}
+
+// 文件变化时自动增量重新加载
+void ReqifParser::setAutoReload(bool enabled) {
+    if (!enabled) {
+        delete m_watcher;
+        m_watcher = nullptr;
+        delete m_reloadTimer;
+        m_reloadTimer = nullptr;
+        return;
+    }
+    if (m_watcher) return;
+
+    m_watcher = new QFileSystemWatcher(this);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &ReqifParser::onFileChanged);
+    m_reloadTimer = new QTimer(this);
+    m_reloadTimer->setSingleShot(true);
+    m_reloadTimer->setInterval(500);
+    connect(m_reloadTimer, &QTimer::timeout, this, &ReqifParser::onReloadTimeout);
+    if (!m_filePath.isEmpty()) {
+        m_watcher->addPath(m_filePath);
+    }
+}
+
+// 监视的文件发生变化：导出工具通常分多次写入，延迟处理
+void ReqifParser::onFileChanged(const QString &filePath) {
+    Q_UNUSED(filePath);
+    m_reloadTimer->start();
+}
+
+// 重新加载（替换式保存会使监视失效，需要重新添加）
+void ReqifParser::onReloadTimeout() {
+    if (!QFileInfo::exists(m_filePath)) {
+        m_reloadTimer->start(); // 文件尚在替换中，稍后重试
+        return;
+    }
+    if (!m_watcher->files().contains(m_filePath)) {
+        m_watcher->addPath(m_filePath);
+    }
+    if (!reload()) {
+        emit reloadFailed(m_errorString);
+    }
 }
 
 // 核心XML解析逻辑
@@ -26,22 +358,34 @@ bool ReqifParser::parseXml(const QString &xmlPath) {
     QFile xmlFile(xmlPath);
     // 1. 打开文件校验
     if (!xmlFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QMessageBox::critical(nullptr, u8"错误", u8"无法打开文件：" + xmlFile.errorString());
+        reportError(u8"错误", u8"无法打开文件：" + xmlFile.errorString());
         return false;
     }
     // 2. 空文件校验
     if (xmlFile.size() == 0) {
-        QMessageBox::critical(nullptr, u8"错误", u8"文件为空，无法解析");
+        reportError(u8"错误", u8"文件为空，无法解析");
         xmlFile.close();
         return false;
     }
+    return parseDocument(&xmlFile);
+}
 
-    QXmlStreamReader xml(&xmlFile);
+// 解析XML内容（完整文件，或延迟加载时按规格拼接的片段）
+bool ReqifParser::parseDocument(QIODevice *device) {
+    QXmlStreamReader xml(device);
     xml.setNamespaceProcessing(true); // 启用命名空间处理
 
     QString currentReqId;
     ReqData currentReq;
+    RawReqText currentRaw;         // 当前需求的原始XHTML
+    QVector<RawReqText> pending;   // 待后处理的需求（分批处理，原始XHTML不累积到文档结束）
+    qint64 pendingChars = 0;       // 本批原始XHTML字符数
+    bool duplicates = false;       // 本批是否出现重复的需求ID
     bool inSpecifications = false; // 标记是否在规格层次区域
+    m_integrity = IntegrityState();
+    m_parsedIds.clear();
+    m_linkedIds.clear();
+    m_previousParents.clear();
 
     // 3. 遍历XML节点
     while (!xml.atEnd() && !xml.hasError()) {
@@ -49,84 +393,608 @@ bool ReqifParser::parseXml(const QString &xmlPath) {
 
         if (token == QXmlStreamReader::StartElement) {
             // 3.1 解析根节点：获取ReqIF命名空间（默认值兜底）
-            if (xml.name().toString().compare("REQ-IF", Qt::CaseInsensitive) == 0) {
+            if (xml.name().compare(QLatin1String("REQ-IF"), Qt::CaseInsensitive) == 0) {
                 m_reqifNamespace = xml.namespaceUri().toString();
                 if (m_reqifNamespace.isEmpty()) {
                     m_reqifNamespace = "http://www.omg.org/spec/ReqIF/20110401/reqif.xsd";
                 }
+                m_namespaceDecls = xml.namespaceDeclarations();
             }
             // 3.2 解析需求对象：初始化当前需求
             else if (isReqifElement(xml, "SPEC-OBJECT")) {
-                currentReqId = xml.attributes().value("IDENTIFIER").toString();
+                currentReqId = intern(xml.attributes().value(QLatin1String("IDENTIFIER")).toString());
                 currentReq = ReqData(); // 重置当前需求
+                currentRaw = RawReqText();
                 currentReq.id = currentReqId;
+                m_objectOrdinal = 0;
+                if (currentReqId.isEmpty()) {
+                    ReqDiagnostic diagnostic;
+                    diagnostic.kind = ReqDiagnostic::EmptyIdentifier;
+                    diagnostic.line = sourceLine(xml.lineNumber());
+                    addDiagnostic(diagnostic, &xml);
+                }
+            }
+            // 3.2.1 记录属性定义（SPEC-TYPES中的ATTRIBUTE-DEFINITION-*，不含*-REF引用）
+            else if (xml.name().startsWith(QLatin1String("ATTRIBUTE-DEFINITION-"), Qt::CaseInsensitive) &&
+                     !xml.name().endsWith(QLatin1String("-REF"), Qt::CaseInsensitive) &&
+                     xml.namespaceUri() == m_reqifNamespace) {
+                m_integrity.attributeDefs.insert(xml.attributes().value(QLatin1String("IDENTIFIER")).toString());
+            }
+            else if (isReqifElement(xml, "SPEC-TYPES")) {
+                m_integrity.typesSeen = true;
             }
             // 3.3 标记进入规格区域：后续优先解析层次
             else if (isReqifElement(xml, "SPECIFICATIONS")) {
                 inSpecifications = true;
             }
-            // 3.4 解析层次结构：仅在规格区域内处理
+            // 3.4 记录所属规格：层次结构的第一级即该规格的根需求
+            else if (inSpecifications && isReqifElement(xml, "SPECIFICATION")) {
+                const QString specId = xml.attributes().value(QLatin1String("IDENTIFIER")).toString();
+                m_currentSpec = -1;
+                for (int i = 0; i < m_specs.size(); ++i) {
+                    if (m_specs.at(i).id == specId) m_currentSpec = i;
+                }
+                if (m_currentSpec < 0) {
+                    ReqSpecification spec;
+                    spec.id = specId;
+                    m_specs.append(spec);
+                    m_currentSpec = m_specs.size() - 1;
+                }
+                m_specs[m_currentSpec].name = xml.attributes().value(QLatin1String("LONG-NAME")).toString();
+                m_specs[m_currentSpec].loaded = true;
+            }
+            // 3.5 解析层次结构：仅在规格区域内处理
             else if (inSpecifications && isReqifElement(xml, "SPEC-HIERARCHY")) {
-                parseHierarchy(xml, ""); // 顶层需求无父ID
+                if (m_sink) {
+                    xml.skipCurrentElement(); // 流式导出不建立层次
+                } else {
+                    QSet<QString> ancestors;
+                    parseHierarchy(xml, "", ancestors); // 顶层需求无父ID
+                }
             }
-            // 3.5 解析整数属性：提取排序号
+            // 3.6 解析整数属性：提取排序号
             else if (isReqifElement(xml, "ATTRIBUTE-VALUE-INTEGER")) {
                 parseIntegerAttribute(xml, currentReq);
             }
-            // 3.6 解析XHTML属性：提取名称/描述
+            // 3.7 解析字符串属性：提取章节号
+            else if (isReqifElement(xml, "ATTRIBUTE-VALUE-STRING")) {
+                parseStringAttribute(xml, currentReq);
+            }
+            // 3.8 解析XHTML属性：提取名称/描述
             else if (isReqifElement(xml, "ATTRIBUTE-VALUE-XHTML")) {
-                parseXhtmlAttribute(xml, currentReq);
+                parseXhtmlAttribute(xml, currentReq, currentRaw);
             }
         }
-        // 3.7 处理结束标签：保存需求或退出规格区域
+        // 3.9 处理结束标签：保存需求或退出规格区域
         else if (token == QXmlStreamReader::EndElement) {
             if (isReqifElement(xml, "SPEC-OBJECT") && !currentReqId.isEmpty()) {
-                m_reqMap[currentReqId] = currentReq; // 保存当前需求
+                if (m_indexBuilder && m_indexBuilder->contains(currentReqId)) {
+                    ReqDiagnostic diagnostic;
+                    diagnostic.kind = ReqDiagnostic::DuplicateId;
+                    diagnostic.reqId = currentReqId;
+                    diagnostic.line = sourceLine(xml.lineNumber());
+                    addDiagnostic(diagnostic, &xml);
+                }
+                if (m_sink || m_indexBuilder) {
+                    ReqStatistics unused;
+                    currentRaw.req = &currentReq;
+                    processReq(currentRaw, m_keepRichText, nullptr, m_textScratch, unused);
+                    if (m_sink) {
+                        // 直接写出，不进入需求存储；首次写入失败即中止解析
+                        if (!m_sink->write(currentReq, QString())) {
+                            xml.raiseError(m_sink->errorString());
+                        }
+                    } else {
+                        m_indexBuilder->addReq(currentReq);  // 写入磁盘索引
+                    }
+                } else {
+                    const bool exists = m_reqMap.contains(currentReqId);
+                    ReqData &stored = m_reqMap[currentReqId];
+                    if (!exists) m_parsedIds.append(currentReqId);
+                    if (exists) {
+                        // 重复ID：后出现的覆盖先出现的；先出现的若已在之前批次计入统计则撤销
+                        bool inBatch = false;
+                        for (const RawReqText &raw : pending) {
+                            if (raw.req == &stored) inBatch = true;
+                        }
+                        if (!inBatch) m_stats.remove(stored);
+                        m_fingerprints.remove(currentReqId); // 描述已卸载时记录的是被覆盖内容的指纹
+                        duplicates = true;
+                        ReqDiagnostic diagnostic;
+                        diagnostic.kind = ReqDiagnostic::DuplicateId;
+                        diagnostic.reqId = currentReqId;
+                        diagnostic.line = sourceLine(xml.lineNumber());
+                        addDiagnostic(diagnostic, &xml);
+                    }
+                    stored = std::move(currentReq); // 移入需求存储，不复制（Qt5的QMap::insert按引用复制）
+                    currentRaw.req = &stored;       // QMap节点地址在插入其他键时不变
+                    pendingChars += currentRaw.name.size() + currentRaw.description.size();
+                    pending.append(std::move(currentRaw));
+                    if (pending.size() >= PendingBatchSize || pendingChars >= PendingBatchChars) {
+                        flushPending(pending, duplicates);
+                        pendingChars = 0;
+                        duplicates = false;
+                    }
+                }
                 currentReqId.clear();
             }
+            else if (isReqifElement(xml, "SPECIFICATION")) {
+                m_currentSpec = -1;
+            }
             else if (isReqifElement(xml, "SPECIFICATIONS")) {
                 inSpecifications = false;
             }
+            else if (isReqifElement(xml, "SPEC-TYPES")) {
+                m_integrity.typesClosed = true;
+            }
+            else if (isReqifElement(xml, "SPEC-OBJECTS")) {
+                m_integrity.objectsClosed = true;
+            }
+        }
+    }
+
+    // 复核出现时尚不能判定的引用（对象或属性定义在引用之后出现）
+    if (!xml.hasError()) {
+        foreach (const ReqDiagnostic &diagnostic, m_integrity.pending) {
+            const bool resolved = diagnostic.kind == ReqDiagnostic::DanglingReference
+                                  ? isKnownReq(diagnostic.reqId)
+                                  : !m_integrity.typesSeen || m_integrity.attributeDefs.contains(diagnostic.detail);
+            if (!resolved) addDiagnostic(diagnostic);
         }
     }
+    m_integrity = IntegrityState();
 
-    // 4. 解析错误处理
+    flushPending(pending, duplicates); // 出错时也处理已解析的部分，保持存储一致
+
+    // 4. 解析错误处理（严格模式下的完整性问题经raiseError中止）
     if (xml.hasError()) {
-        QString errorMsg = QString(u8"XML解析错误：%1\n行号：%2\n列号：%3")
-                           .arg(xml.errorString())
-                           .arg(xml.lineNumber())
-                           .arg(xml.columnNumber());
+        QString errorMsg;
+        if (xml.error() == QXmlStreamReader::CustomError && m_sink && !m_sink->errorString().isEmpty()) {
+            errorMsg = QString(u8"导出写入失败：%1").arg(xml.errorString());
+        } else if (xml.error() == QXmlStreamReader::CustomError) {
+            errorMsg = QString(u8"完整性检查失败（严格模式）：%1").arg(xml.errorString());
+        } else {
+            errorMsg = QString(u8"XML解析错误：%1\n行号：%2\n列号：%3")
+                       .arg(xml.errorString())
+                       .arg(sourceLine(xml.lineNumber()))
+                       .arg(sourceColumn(xml.lineNumber(), xml.columnNumber()));
+        }
         if (errorMsg.contains("Premature end of document", Qt::CaseInsensitive)) {
             errorMsg += u8"\n建议：检查文件是否完整或重新获取";
         }
-        QMessageBox::critical(nullptr, u8"解析失败", errorMsg);
-        xmlFile.close();
+        reportError(u8"解析失败", errorMsg);
+        device->close();
         return false;
     }
 
-    xmlFile.close();
+    device->close();
+    if (!failOnDiagnostics()) return false;
+    if (m_sink || m_indexBuilder) return true;
+
+    // 5. 层次补充、层级计算、顶层列表与索引（延迟加载规格时只处理本次新增的需求）
+    if (m_lazyLoading && !m_specRanges.isEmpty() && !m_parentMap.isEmpty()) {
+        finishHierarchyIncremental();
+    } else {
+        finishHierarchy();
+    }
+    if (!failOnDiagnostics()) return false;
+    enforceMemoryBudget();
+
+    // 6. 解析结果日志
+    qDebug() << u8"解析完成 | 总需求：" << getAllReqCount() << u8"有效需求：" << getValidReqCount();
+    return getValidReqCount() > 0;
+}
 
-    // 5. 层次结构补充：无显式层次时从排序号推断
+// 解析后处理（延迟加载时每加载一个规格重新执行）
+void ReqifParser::finishHierarchy() {
+    // 1. 层次结构补充：无显式层次时从排序号推断（推断同时给出层级）
     if (m_parentMap.isEmpty()) {
-        inferHierarchyFromSortNumbers();
+        inferHierarchy();
     }
-    // 6. 计算所有需求层级
-    for (auto &req : m_reqMap) {
-        if (req.level <= 1) {
+    // 2. 显式层次：断开成环关系后按父链深度计算所有需求层级（与树中深度一致）
+    else {
+        breakHierarchyCycles(m_parentMap.keys());
+        for (auto &req : m_reqMap) {
             req.level = calculateLevel(req.id);
         }
     }
-    // 7. 更新顶层需求列表
+    // 3. 更新顶层需求列表
     updateTopLevelReqs();
+    buildChildMap();
+    buildTextIndex();
+}
 
-    // 8. 解析结果日志
-    qDebug() << u8"解析完成 | 总需求：" << getAllReqCount() << u8"有效需求：" << getValidReqCount();
+// 延迟加载规格后的增量处理：已加载规格的需求不重新遍历
+// 层次来自规格的SPEC-HIERARCHY（无显式层次需要整体推断时走finishHierarchy）
+void ReqifParser::finishHierarchyIncremental() {
+    QStringList touched = m_parsedIds + m_linkedIds;
+    touched.removeDuplicates();
+
+    // 0. 各需求当前在父->子索引中所属的父需求（新需求尚未列入；重新挂载的取解析前的父需求）
+    const QSet<QString> parsed = m_parsedIds.toSet();
+    QHash<QString, QString> listedParents;
+    foreach (const QString &reqId, touched) {
+        auto it = m_reqMap.constFind(reqId);
+        if (it == m_reqMap.constEnd() || parsed.contains(reqId)) continue;
+        listedParents.insert(reqId, m_previousParents.value(reqId, it->parentId));
+    }
+
+    // 1. 断开成环关系（会清除父需求，先于顶层列表计算）；环可能经由之前加载的需求，断开的需求一并处理
+    QStringList affected = touched;
+    const QHash<QString, QString> broken = breakHierarchyCycles(touched);
+    const QSet<QString> touchedSet = touched.toSet();
+    for (auto it = broken.constBegin(); it != broken.constEnd(); ++it) {
+        if (touchedSet.contains(it.key()) || !m_reqMap.contains(it.key())) continue;
+        listedParents.insert(it.key(), it.value());
+        affected.append(it.key());
+    }
+    // 2. 顶层列表（保持按ID排序，与updateTopLevelReqs一致）与父->子索引
+    // 父需求变化（重新挂载或断开成环关系）的需求从原父需求的子列表移出，受影响的列表各重建一次
+    QHash<QString, QSet<QString>> detached;
+    foreach (const QString &reqId, affected) {
+        auto it = m_reqMap.constFind(reqId);
+        if (it == m_reqMap.constEnd()) continue;
+        const auto pos = std::lower_bound(m_topReqIds.begin(), m_topReqIds.end(), reqId);
+        const bool listed = pos != m_topReqIds.end() && *pos == reqId;
+        const bool top = !m_parentMap.contains(reqId) && isValidReq(*it);
+        if (top && !listed) {
+            m_topReqIds.insert(pos, reqId);
+        } else if (!top && listed) {
+            m_topReqIds.erase(pos);
+        }
+        const QString listed = listedParents.value(reqId);
+        if (listed == it->parentId) continue;
+        if (!listed.isEmpty()) detached[listed].insert(reqId);
+        if (!it->parentId.isEmpty()) m_childMap[it->parentId].append(reqId);
+    }
+    for (auto it = detached.constBegin(); it != detached.constEnd(); ++it) {
+        auto children = m_childMap.find(it.key());
+        if (children == m_childMap.end()) continue;
+        QStringList kept;
+        kept.reserve(children->size());
+        foreach (const QString &childId, *children) {
+            if (!it.value().contains(childId)) kept.append(childId);
+        }
+        if (kept.isEmpty()) {
+            m_childMap.erase(children);
+        } else {
+            *children = kept;
+        }
+    }
+    // 3. 层级：父链可能变化的需求及其全部后代按父链深度重新计算
+    QSet<QString> levelled;
+    QStringList queue = affected;
+    for (int i = 0; i < queue.size(); ++i) {
+        const QString reqId = queue.at(i);
+        if (levelled.contains(reqId)) continue;
+        levelled.insert(reqId);
+        auto it = m_reqMap.find(reqId);
+        if (it != m_reqMap.end()) it->level = calculateLevel(reqId);
+        queue += m_childMap.value(reqId);
+    }
+    // 4. 检索索引只追加新需求
+    m_textIndex.setStringPool(m_stringPool);
+    foreach (const QString &reqId, m_parsedIds) {
+        auto it = m_reqMap.constFind(reqId);
+        m_textIndex.add(reqId, it->name, it->description);
+    }
+}
+
+// 只读取根元素：ReqIF命名空间与命名空间声明（片段拼接与导出时沿用）
+bool ReqifParser::readRootElement(const QString &xmlPath) {
+    QFile xmlFile(xmlPath);
+    if (!xmlFile.open(QIODevice::ReadOnly)) {
+        reportError(u8"错误", u8"无法打开文件：" + xmlFile.errorString());
+        return false;
+    }
+    QXmlStreamReader xml(&xmlFile);
+    xml.setNamespaceProcessing(true);
+    while (!xml.atEnd() && xml.readNext() != QXmlStreamReader::StartElement) {}
+    if (xml.hasError() || xml.name().compare(QLatin1String("REQ-IF"), Qt::CaseInsensitive) != 0) {
+        reportError(u8"解析失败", u8"不是有效的ReqIF文件");
+        return false;
+    }
+    m_reqifNamespace = xml.namespaceUri().toString();
+    if (m_reqifNamespace.isEmpty()) {
+        m_reqifNamespace = "http://www.omg.org/spec/ReqIF/20110401/reqif.xsd";
+    }
+    m_namespaceDecls = xml.namespaceDeclarations();
+    return true;
+}
+
+// 超大文件模式：索引与源文件版本、富文本设置一致时直接打开，否则流式解析一遍写入索引
+// 需求、层次与检索文本都在磁盘上，内存只保留ID -> 记录序号（仅构建期间）与当前映射的窗口
+bool ReqifParser::loadOutOfCore(const QString &filePath) {
+    if (!readRootElement(filePath)) return false;
+
+    QElapsedTimer timer;
+    timer.start();
+    const QString indexPath = ReqDiskIndex::defaultPath(filePath);
+    ReqDiskIndex *index = new ReqDiskIndex;
+    ReqIndexOptions options;
+    options.richText = m_keepRichText;
+    options.rule = m_hierarchyRule;
+    options.outlineKey = m_outlineAttribute;
+    bool rebuilt = false;
+    // 完整性诊断在流式解析时收集，严格模式下不沿用已有索引
+    if (m_strict || !index->open(indexPath, filePath, options)) {
+        ReqDiskIndexBuilder builder;
+        if (!builder.begin(indexPath, filePath, options)) {
+            reportError(u8"错误", builder.errorString());
+            delete index;
+            return false;
+        }
+        m_indexBuilder = &builder;
+        const bool parsed = parseXml(filePath);
+        m_indexBuilder = nullptr;
+        if (!parsed) {
+            builder.abort();
+            delete index;
+            return false;
+        }
+        if (!builder.finish()) {
+            builder.abort(); // 删除未完成的版本文件
+            reportError(u8"错误", builder.errorString());
+            delete index;
+            return false;
+        }
+        if (!index->open(indexPath, filePath, options)) {
+            reportError(u8"错误", u8"无法打开磁盘索引：" + index->errorString());
+            delete index;
+            return false;
+        }
+        rebuilt = true;
+    }
+    m_diskIndex = index;
+    m_stats = ReqStatistics();
+    m_stats.valid = m_diskIndex->validCount();
+
+    qDebug() << (rebuilt ? u8"磁盘索引已重建 |" : u8"磁盘索引已打开 |") << u8"总需求：" << getAllReqCount()
+             << u8"有效需求：" << getValidReqCount() << u8"耗时(ms)：" << timer.elapsed() << indexPath;
     return getValidReqCount() > 0;
 }
 
+// 延迟加载：解析根元素命名空间，扫描原始字节索引各规格及SPEC-OBJECT的字节区间
+bool ReqifParser::indexSpecifications(const QString &xmlPath) {
+    if (!readRootElement(xmlPath)) return false;
+
+    ReqifRawFile raw;
+    if (!raw.open(xmlPath)) {
+        reportError(u8"错误", u8"无法读取文件：" + raw.errorString());
+        return false;
+    }
+    // 原始字节扫描只支持ASCII兼容的编码，UTF-16/UTF-32文件一次完整解析（各规格均视为已加载）
+    if (raw.wideCodec()) {
+        qDebug() << u8"宽字符编码文件不支持延迟加载，完整解析 |" << raw.wideCodec()->name();
+        raw.close();
+        return parseXml(xmlPath);
+    }
+    QTextCodec *codec = QTextCodec::codecForName(raw.encoding());
+    if (!codec) codec = QTextCodec::codecForName("UTF-8");
+    captureScopeDeclarations(raw);
+
+    const ReqifByteRange specifications = raw.findElement("SPECIFICATIONS", raw.whole());
+    ReqifByteRange rest = raw.contentRange(specifications);
+    qint64 specLineScanned = 0;
+    int specLine = 1;
+    while (rest.isValid()) {
+        const ReqifByteRange element = raw.findElement("SPECIFICATION", rest);
+        if (!element.isValid()) break;
+        rest.begin = element.end;
+        specLine += int(std::count(raw.data() + specLineScanned, raw.data() + element.begin, '\n'));
+        specLineScanned = element.begin;
+
+        ReqSpecification spec;
+        spec.id = QString::fromUtf8(raw.attribute(element, "IDENTIFIER"));
+        // 名称为原始字节，按文件编码解码并还原基本实体
+        spec.name = codec->toUnicode(raw.attribute(element, "LONG-NAME"));
+        spec.name.replace("&lt;", "<").replace("&gt;", ">").replace("&quot;", "\"")
+                 .replace("&apos;", "'").replace("&amp;", "&");
+        m_specs.append(spec);
+        m_specRanges.insert(spec.id, element);
+        m_specLines.insert(spec.id, specLine);
+    }
+    // 需求对象字节区间；片段按ID回读时看不到空ID与重复ID，在此随扫描一并检查
+    ReqifByteRange objects = raw.whole();
+    qint64 lineScanned = 0;
+    int line = 1;
+    for (;;) {
+        const ReqifByteRange element = raw.findElement("SPEC-OBJECT", objects);
+        if (!element.isValid()) break;
+        objects.begin = element.end;
+        line += int(std::count(raw.data() + lineScanned, raw.data() + element.begin, '\n'));
+        lineScanned = element.begin;
+
+        const QString reqId = QString::fromUtf8(raw.attribute(element, "IDENTIFIER"));
+        ReqDiagnostic diagnostic;
+        diagnostic.reqId = reqId;
+        diagnostic.line = line;
+        if (reqId.isEmpty()) {
+            diagnostic.kind = ReqDiagnostic::EmptyIdentifier;
+            addDiagnostic(diagnostic);
+            continue;
+        }
+        if (m_specObjectRanges.contains(reqId)) {
+            diagnostic.kind = ReqDiagnostic::DuplicateId;
+            addDiagnostic(diagnostic);
+        }
+        m_specObjectRanges.insert(reqId, element); // 后出现的覆盖先出现的，与完整解析一致
+        m_specObjectLines.insert(reqId, line);
+    }
+    raw.close(); // 不长期占用文件，导出工具可以替换
+    if (!failOnDiagnostics()) return false;
+
+    qDebug() << u8"规格索引完成 | 规格：" << m_specs.size() << u8"需求对象：" << m_specObjectRanges.size();
+    if (m_specs.isEmpty()) {
+        reportError(u8"解析失败", u8"文件中没有规格（SPECIFICATION）");
+        return false;
+    }
+    return true;
+}
+
+// 加载规格：回读该规格及其引用的SPEC-OBJECT原始字节，拼成最小文档后按常规流程解析
+bool ReqifParser::loadSpecification(const QString &specId) {
+    int index = -1;
+    for (int i = 0; i < m_specs.size(); ++i) {
+        if (m_specs.at(i).id == specId) index = i;
+    }
+    if (index < 0) {
+        m_errorString = u8"未找到规格：" + specId;
+        return false;
+    }
+    if (m_specs.at(index).loaded) return true;
+
+    const QFileInfo info(m_filePath);
+    if (info.size() != m_indexedSize || info.lastModified() != m_indexedTime) {
+        m_errorString = u8"文件已变化，请重新加载";
+        return false;
+    }
+    ReqifRawFile raw;
+    if (!raw.open(m_filePath)) {
+        m_errorString = u8"无法读取文件：" + raw.errorString();
+        return false;
+    }
+
+    const ReqifByteRange specRange = m_specRanges.value(specId);
+
+    // 每个片段另起一行，记录其在拼接文档与源文件中的起始行，诊断与错误位置换算回源文件
+    QVector<FragmentLine> fragmentLines;
+    int docLine = 1; // XML声明、根元素与SPEC-OBJECTS开始标签在第1行
+    auto appendFragment = [&](QByteArray &target, const ReqifByteRange &range, int line) {
+        qint64 lineStart = range.begin;
+        while (lineStart > 0 && raw.data()[lineStart - 1] != '\n') --lineStart;
+        FragmentLine fragment;
+        fragment.docLine = ++docLine;
+        fragment.line = line;
+        fragment.column = int(range.begin - lineStart);
+        fragmentLines.append(fragment);
+        const QByteArray bytes = raw.bytes(range);
+        target += '\n';
+        target += bytes;
+        docLine += bytes.count('\n');
+    };
+
+    // 层次中引用的需求对象（其他规格已加载的、本规格中已加入片段的跳过，避免误报重复ID）
+    QByteArray objects;
+    QSet<QString> queued;
+    ReqifByteRange rest = specRange;
+    int objectCount = 0;
+    while (rest.isValid()) {
+        const ReqifByteRange ref = raw.findElement("SPEC-OBJECT-REF", rest);
+        if (!ref.isValid()) break;
+        rest.begin = ref.end;
+        const QString reqId = QString::fromUtf8(raw.bytes(raw.contentRange(ref)).trimmed());
+        if (m_reqMap.contains(reqId) || queued.contains(reqId)) continue;
+        queued.insert(reqId);
+        const ReqifByteRange object = m_specObjectRanges.value(reqId);
+        if (!object.isValid()) continue;
+        appendFragment(objects, object, m_specObjectLines.value(reqId));
+        ++objectCount;
+    }
+    QByteArray specification;
+    appendFragment(specification, specRange, m_specLines.value(specId));
+    QByteArray document = fragmentDocument(raw, objects, specification);
+    raw.close();
+
+    QBuffer buffer(&document);
+    buffer.open(QIODevice::ReadOnly);
+    m_errorString.clear();
+    m_fragmentLines.swap(fragmentLines);
+    const bool parsed = parseDocument(&buffer);
+    m_fragmentLines.clear();
+    if (!parsed && !m_errorString.isEmpty()) {
+        return false; // XML错误（规格中没有有效需求不算失败）
+    }
+    m_specs[index].loaded = true;
+    qDebug() << u8"规格加载完成 |" << m_specs.at(index).name << u8"新增需求对象：" << objectCount;
+    return true;
+}
+
+// 由原始字节拼接可解析的最小文档：SPEC-OBJECTS下放objects，specification非空时放在SPECIFICATIONS下
+// 片段中的元素沿用根元素上的命名空间声明与前缀，中间层级上的声明补在对应的包装元素上
+QByteArray ReqifParser::fragmentDocument(const ReqifRawFile &raw, const QByteArray &objects,
+                                         const QByteArray &specification) const {
+    QString prefix;
+    QByteArray rootAttrs;
+    foreach (const QXmlStreamNamespaceDeclaration &decl, m_namespaceDecls) {
+        if (decl.namespaceUri() == m_reqifNamespace) prefix = decl.prefix().toString();
+        rootAttrs += decl.prefix().isEmpty() ? QByteArray(" xmlns=\"")
+                                             : " xmlns:" + decl.prefix().toUtf8() + "=\"";
+        rootAttrs += decl.namespaceUri().toString().toHtmlEscaped().toUtf8() + '"';
+    }
+    const QByteArray p = prefix.isEmpty() ? QByteArray() : prefix.toUtf8() + ':';
+
+    QByteArray document;
+    document.reserve(objects.size() + specification.size() + 512);
+    document += "<?xml version=\"1.0\" encoding=\"" + raw.encoding() + "\"?>";
+    document += "<" + p + "REQ-IF" + rootAttrs + "><" + p + "SPEC-OBJECTS" + m_objectScopeDecls + ">";
+    document += objects;
+    document += "</" + p + "SPEC-OBJECTS>";
+    if (!specification.isEmpty()) {
+        document += "<" + p + "SPECIFICATIONS" + m_specScopeDecls + ">" + specification + "</" + p + "SPECIFICATIONS>";
+    }
+    document += "</" + p + "REQ-IF>";
+    return document;
+}
+
+// 片段文档行号换算：落在某片段内的行按该片段在源文件中的起始行偏移，包装元素所在的第1行无法对应
+int ReqifParser::sourceLine(qint64 line) const {
+    if (m_fragmentLines.isEmpty()) return int(line);
+    const auto it = std::upper_bound(m_fragmentLines.constBegin(), m_fragmentLines.constEnd(), line,
+                                     [](qint64 value, const FragmentLine &fragment) { return value < fragment.docLine; });
+    if (it == m_fragmentLines.constBegin()) return 0;
+    const FragmentLine &fragment = *(it - 1);
+    return fragment.line + int(line - fragment.docLine);
+}
+
+// 片段文档列号换算：片段首行需加上片段起点在源文件该行中的偏移
+int ReqifParser::sourceColumn(qint64 line, qint64 column) const {
+    if (m_fragmentLines.isEmpty()) return int(column);
+    const auto it = std::upper_bound(m_fragmentLines.constBegin(), m_fragmentLines.constEnd(), line,
+                                     [](qint64 value, const FragmentLine &fragment) { return value < fragment.docLine; });
+    if (it == m_fragmentLines.constBegin()) return int(column);
+    const FragmentLine &fragment = *(it - 1);
+    return int(column) + (line == fragment.docLine ? fragment.column : 0);
+}
+
+// 片段所在层级上的命名空间声明：CORE-CONTENT、REQ-IF-CONTENT与SPEC-OBJECTS/SPECIFICATIONS的开始标签
+// 内层覆盖外层，拼成属性文本；只读开始标签，不扫描到外层元素的结束标签
+void ReqifParser::captureScopeDeclarations(const ReqifRawFile &raw) {
+    auto after = [&raw](const ReqifByteRange &tag) {
+        ReqifByteRange rest = raw.whole();
+        if (tag.isValid()) rest.begin = tag.end;
+        return rest;
+    };
+    auto serialize = [&raw](const QList<ReqifByteRange> &tags) {
+        ReqifAttributeList merged;
+        foreach (const ReqifByteRange &tag, tags) {
+            foreach (const auto &decl, raw.namespaceDeclarations(tag)) {
+                int k = 0;
+                while (k < merged.size() && merged.at(k).first != decl.first) ++k;
+                if (k < merged.size()) merged[k] = decl; else merged.append(decl);
+            }
+        }
+        QByteArray attrs;
+        foreach (const auto &decl, merged) {
+            const char quote = decl.second.contains('"') ? '\'' : '"';
+            attrs += ' ' + decl.first + '=' + quote + decl.second + quote;
+        }
+        return attrs;
+    };
+
+    const ReqifByteRange core = raw.findStartTag("CORE-CONTENT", raw.whole());
+    const ReqifByteRange content = raw.findStartTag("REQ-IF-CONTENT", after(core));
+    const ReqifByteRange objects = raw.findStartTag("SPEC-OBJECTS", after(content));
+    const ReqifByteRange specifications = raw.findStartTag("SPECIFICATIONS", after(content));
+    m_objectScopeDecls = serialize(QList<ReqifByteRange>() << core << content << objects);
+    m_specScopeDecls = serialize(QList<ReqifByteRange>() << core << content << specifications);
+}
+
 // 递归解析需求层次结构
-void ReqifParser::parseHierarchy(QXmlStreamReader &xml, const QString &parentId) {
+// 引用的对象尚未出现时记为待复核；引用嵌套路径上的祖先视为成环，忽略该关系
+void ReqifParser::parseHierarchy(QXmlStreamReader &xml, const QString &parentId, QSet<QString> &ancestors) {
     QString currentChildId;
+    bool linked = true; // 当前引用是否建立了父子关系
 
     while (!xml.atEnd() && !xml.hasError()) {
         QXmlStreamReader::TokenType token = xml.readNext();
@@ -134,24 +1002,62 @@ void ReqifParser::parseHierarchy(QXmlStreamReader &xml, const QString &parentId)
         if (token == QXmlStreamReader::StartElement) {
             // 读取子需求ID
             if (isReqifElement(xml, "SPEC-OBJECT-REF")) {
-                currentChildId = xml.readElementText().trimmed();
-                if (!currentChildId.isEmpty()) {
+                currentChildId = intern(xml.readElementText().trimmed());
+                linked = true;
+                if (!currentChildId.isEmpty() && !isKnownReq(currentChildId)) {
+                    ReqDiagnostic diagnostic;
+                    diagnostic.kind = ReqDiagnostic::DanglingReference;
+                    diagnostic.reqId = currentChildId;
+                    diagnostic.detail = parentId;
+                    diagnostic.line = sourceLine(xml.lineNumber());
+                    if (m_integrity.objectsClosed) {
+                        addDiagnostic(diagnostic, &xml);
+                    } else {
+                        m_integrity.pending.append(diagnostic);
+                    }
+                }
+                if (!currentChildId.isEmpty() && (currentChildId == parentId || ancestors.contains(currentChildId))) {
+                    ReqDiagnostic diagnostic;
+                    diagnostic.kind = ReqDiagnostic::HierarchyCycle;
+                    diagnostic.reqId = currentChildId;
+                    diagnostic.detail = parentId;
+                    diagnostic.line = sourceLine(xml.lineNumber());
+                    addDiagnostic(diagnostic, &xml);
+                    linked = false;
+                }
+                if (!currentChildId.isEmpty() && linked) {
+                    // 超大文件模式：父子关系直接在磁盘索引上链接（规格不分组）
+                    if (m_indexBuilder) {
+                        m_indexBuilder->addChild(parentId, currentChildId);
+                    }
                     // 建立父子关系
-                    if (!parentId.isEmpty()) {
+                    else if (!parentId.isEmpty()) {
                         m_parentMap[currentChildId] = parentId;
-                        if (m_reqMap.contains(currentChildId)) {
-                            m_reqMap[currentChildId].parentId = parentId;
+                        auto stored = m_reqMap.find(currentChildId);
+                        if (stored != m_reqMap.end()) {
+                            // 记录解析前的父需求，增量处理时从其子列表中移除
+                            if (!m_previousParents.contains(currentChildId)) {
+                                m_previousParents.insert(currentChildId, stored->parentId);
+                            }
+                            stored->parentId = parentId;
                         }
+                        m_linkedIds.append(currentChildId);
                     }
-                    // 顶层需求加入列表
-                    else if (!m_topReqIds.contains(currentChildId)) {
-                        m_topReqIds.append(currentChildId);
+                    // 第一级需求作为所属规格的根需求（顶层列表在解析结束后统一生成）
+                    else if (m_currentSpec >= 0) {
+                        m_specs[m_currentSpec].rootIds.append(currentChildId);
+                        m_linkedIds.append(currentChildId);
                     }
                 }
             }
             // 递归解析子层次
             else if (isReqifElement(xml, "SPEC-HIERARCHY")) {
-                parseHierarchy(xml, currentChildId);
+                // 成环的引用不作为父需求，其子层次挂到上一级
+                const QString childParent = linked ? currentChildId : parentId;
+                const bool pushed = !childParent.isEmpty() && !ancestors.contains(childParent);
+                if (pushed) ancestors.insert(childParent);
+                parseHierarchy(xml, childParent, ancestors);
+                if (pushed) ancestors.remove(childParent);
             }
         }
         // 遇到当前层次结束标签，退出递归
@@ -163,7 +1069,7 @@ void ReqifParser::parseHierarchy(QXmlStreamReader &xml, const QString &parentId)
 
 // 解析整数属性（排序号）
 void ReqifParser::parseIntegerAttribute(QXmlStreamReader &xml, ReqData &currentReq) {
-    QString theValue = xml.attributes().value("THE-VALUE").toString();
+    const int theValue = xml.attributes().value(QLatin1String("THE-VALUE")).toInt(); // 读取后续节点前先取值
     QString defRef; // 属性定义引用
 
     // 仅在当前属性范围内读取
@@ -182,16 +1088,47 @@ void ReqifParser::parseIntegerAttribute(QXmlStreamReader &xml, ReqData &currentR
         }
     }
 
+    checkAttributeDefinition(xml, defRef, currentReq.id);
+
     // 匹配排序号标识（ABSOLUTENUMBER）
-    if (!defRef.isEmpty() && defRef.contains("ABSOLUTENUMBER", Qt::CaseInsensitive)) {
-        currentReq.sortNum = theValue.toInt();
+    if (!defRef.isEmpty() && defRef.contains(QLatin1String("ABSOLUTENUMBER"), Qt::CaseInsensitive)) {
+        currentReq.sortNum = theValue;
+    }
+}
+
+// 解析字符串属性（章节号）
+void ReqifParser::parseStringAttribute(QXmlStreamReader &xml, ReqData &currentReq) {
+    QString theValue = xml.attributes().value(QLatin1String("THE-VALUE")).toString();
+    QString defRef; // 属性定义引用
+
+    // 仅在当前属性范围内读取
+    while (!xml.atEnd()) {
+        QXmlStreamReader::TokenType token = xml.readNext();
+
+        if (token == QXmlStreamReader::StartElement) {
+            if (isReqifElement(xml, "ATTRIBUTE-DEFINITION-STRING-REF")) {
+                defRef = xml.readElementText();
+                break;
+            }
+        }
+        else if (token == QXmlStreamReader::EndElement && isReqifElement(xml, "ATTRIBUTE-VALUE-STRING")) {
+            break;
+        }
+    }
+
+    checkAttributeDefinition(xml, defRef, currentReq.id);
+
+    // 匹配章节号属性
+    if (!defRef.isEmpty() && defRef.contains(m_outlineAttribute, Qt::CaseInsensitive)) {
+        currentReq.outlineNum = theValue.trimmed();
     }
 }
 
 // 解析XHTML属性（名称/描述）
-void ReqifParser::parseXhtmlAttribute(QXmlStreamReader &xml, ReqData &currentReq) {
-    QString defRef;   // 属性定义引用
-    QString theValue; // XHTML内容
+void ReqifParser::parseXhtmlAttribute(QXmlStreamReader &xml, ReqData &currentReq, RawReqText &raw) {
+    QString defRef;                      // 属性定义引用
+    QString &theValue = m_xhtmlScratch;  // XHTML内容（复用缓冲）
+    theValue.resize(0);                  // 保留容量
 
     // 第一步：读取属性定义引用
     while (!xml.atEnd()) {
@@ -200,6 +1137,7 @@ void ReqifParser::parseXhtmlAttribute(QXmlStreamReader &xml, ReqData &currentReq
         if (token == QXmlStreamReader::StartElement) {
             if (isReqifElement(xml, "ATTRIBUTE-DEFINITION-XHTML-REF")) {
                 defRef = xml.readElementText();
+                checkAttributeDefinition(xml, defRef, currentReq.id);
                 break;
             }
         }
@@ -214,7 +1152,8 @@ void ReqifParser::parseXhtmlAttribute(QXmlStreamReader &xml, ReqData &currentReq
         QXmlStreamReader::TokenType token = xml.readNext();
 
         if (token == QXmlStreamReader::StartElement && isReqifElement(xml, "THE-VALUE")) {
-            theValue = readXhtmlContent(xml);
+            readXhtmlContent(xml, currentReq.id, theValue, m_objectOrdinal,
+                             (m_sink || m_indexBuilder) ? nullptr : &m_objectStore);
             break;
         }
         else if (token == QXmlStreamReader::EndElement && isReqifElement(xml, "ATTRIBUTE-VALUE-XHTML")) {
@@ -222,110 +1161,255 @@ void ReqifParser::parseXhtmlAttribute(QXmlStreamReader &xml, ReqData &currentReq
         }
     }
 
-    // 第三步：映射到需求字段
+    // 第三步：保存原始XHTML，清理在后处理阶段进行
+    // 按长度深拷贝，复用缓冲不被共享，下次重置时保留容量
     if (defRef.isEmpty()) return;
-    if (defRef.contains("_valm_Name", Qt::CaseInsensitive)) {
-        currentReq.name = cleanHtml(theValue);
+    if (defRef.contains(QLatin1String("_valm_Name"), Qt::CaseInsensitive)) {
+        raw.name = QString(theValue.constData(), theValue.size());
+        raw.hasName = true;
     }
-    else if (defRef.contains("_valm_Description", Qt::CaseInsensitive)) {
-        currentReq.description = cleanHtml(theValue);
+    else if (defRef.contains(QLatin1String("_valm_Description"), Qt::CaseInsensitive)) {
+        raw.description = QString(theValue.constData(), theValue.size());
+        raw.hasDescription = true;
     }
 }
 
-// 读取嵌套XHTML内容
-QString ReqifParser::readXhtmlContent(QXmlStreamReader &xml) {
-    QString content;
+// 读取嵌套XHTML内容，追加到content（解析期复用缓冲，逐段追加不生成临时字符串）
+// 嵌入对象只记录位置，data属性替换为"reqobj:序号"，避免内联base64进入描述文本
+void ReqifParser::readXhtmlContent(QXmlStreamReader &xml, const QString &reqId, QString &content,
+                                   int &ordinal, ReqObjectStore *store) {
     int depth = 1; // 初始深度（THE-VALUE节点）
 
     while (!xml.atEnd() && depth > 0) {
         QXmlStreamReader::TokenType token = xml.readNext();
 
         switch (token) {
-        case QXmlStreamReader::StartElement:
+        case QXmlStreamReader::StartElement: {
             depth++;
+            const QXmlStreamAttributes attributes = xml.attributes();
+            const bool isObject = xml.name() == QLatin1String("object");
+            QString dataUriType; // 无type属性时由data URI得到的类型，写回内容供净化时识别图片
+            if (isObject) {
+                const QStringRef data = attributes.value(QLatin1String("data"));
+                ReqEmbeddedObject object;
+                object.reqId = reqId;
+                object.ordinal = ordinal++;
+                object.mimeType = attributes.value(QLatin1String("type")).toString();
+                if (data.startsWith(QLatin1String("data:"))) {
+                    if (object.mimeType.isEmpty()) {
+                        // data:[<类型>][;参数...],<数据>，类型截止于第一个';'或','
+                        int end = 5;
+                        while (end < data.size() && data.at(end) != QLatin1Char(';') && data.at(end) != QLatin1Char(','))
+                            ++end;
+                        object.mimeType = data.mid(5, end - 5).toString();
+                        dataUriType = object.mimeType;
+                    }
+                } else {
+                    object.dataRef = data.toString();
+                }
+                if (store) store->add(object);
+            }
             // 拼接开始标签（含属性）
-            content += "<" + xml.name().toString();
-            foreach (const QXmlStreamAttribute &attr, xml.attributes()) {
-                content += " " + attr.name().toString() + "=\"" + attr.value().toString() + "\"";
+            content += QLatin1Char('<');
+            content += xml.name();
+            for (const QXmlStreamAttribute &attr : attributes) {
+                if (isObject && attr.name() == QLatin1String("data")) {
+                    content += QLatin1String(" data=\"reqobj:");
+                    content += QString::number(ordinal - 1);
+                    content += QLatin1Char('"');
+                    continue;
+                }
+                content += QLatin1Char(' ');
+                content += attr.name();
+                content += QLatin1String("=\"");
+                appendEscaped(content, attr.value());
+                content += QLatin1Char('"');
             }
-            content += ">";
+            if (!dataUriType.isEmpty()) {
+                content += QLatin1String(" type=\"");
+                appendEscaped(content, QStringRef(&dataUriType));
+                content += QLatin1Char('"');
+            }
+            content += QLatin1Char('>');
             break;
+        }
         case QXmlStreamReader::EndElement:
             depth--;
             if (depth > 0) {
-                content += "</" + xml.name().toString() + ">";
+                content += QLatin1String("</");
+                content += xml.name();
+                content += QLatin1Char('>');
             }
             break;
         case QXmlStreamReader::Characters:
-            content += xml.text().toString();
+            appendEscaped(content, xml.text()); // 文本保持转义，避免与标签混淆
             break;
         default:
             break;
         }
     }
-    return content;
 }
 
-// 清理HTML标签
-QString ReqifParser::cleanHtml(const QString &htmlText) {
+// 清理HTML标签：单次扫描写入复用缓冲，只为结果分配一次
+// 规则：<br>换行，<div...>空行，<li>项目符号，</li>换行，其余标签移除；解码常用实体
+QString ReqifParser::cleanHtml(const QString &htmlText, QString &scratch) {
     if (htmlText.isEmpty()) return u8"[无内容]";
 
-    QString result = htmlText;
-    // 保留关键格式（换行、列表）
-    result.replace(QRegExp("<br\\s*/?>", Qt::CaseInsensitive), "\n");
-    result.replace(QRegExp("<div[^>]*>", Qt::CaseInsensitive), "\n\n");
-    result.replace(QRegExp("</div>", Qt::CaseInsensitive), "");
-    result.replace(QRegExp("<li>", Qt::CaseInsensitive), "• ");
-    result.replace(QRegExp("</li>", Qt::CaseInsensitive), "\n");
-    // 移除所有剩余标签
-    result.replace(QRegExp("<[^>]*>", Qt::CaseInsensitive), "");
-    // 解码HTML实体
-    result.replace("&amp;", "&");
-    result.replace("&lt;", "<");
-    result.replace("&gt;", ">");
-    result.replace("&nbsp;", " ");
+    QString &out = scratch;
+    out.resize(0); // 保留容量
+    const QChar *begin = htmlText.constData();
+    const QChar *end = begin + htmlText.size();
+    const QChar *plain = begin; // 尚未写出的普通文本起点
+
+    for (const QChar *p = begin; p != end; ++p) {
+        if (*p == QLatin1Char('<')) {
+            const QChar *close = p;
+            while (close != end && *close != QLatin1Char('>')) ++close;
+            if (close == end) continue; // 未闭合的'<'按普通文本保留
+
+            out.append(plain, int(p - plain));
+            const QStringRef tag(&htmlText, int(p - begin), int(close - p) + 1);
+            if (tag.startsWith(QLatin1String("<br"), Qt::CaseInsensitive)) {
+                // <br\s*/?>，其余以br开头的标签（如<bro>）移除
+                const QChar *q = p + 3;
+                while (q != close && q->isSpace()) ++q;
+                if (q != close && *q == QLatin1Char('/')) ++q;
+                if (q == close) out += QLatin1Char('\n');
+            } else if (tag.startsWith(QLatin1String("<div"), Qt::CaseInsensitive)) {
+                out += QLatin1String("\n\n");
+            } else if (tag.compare(QLatin1String("<li>"), Qt::CaseInsensitive) == 0) {
+                out += QChar(0x2022);
+                out += QLatin1Char(' ');
+            } else if (tag.compare(QLatin1String("</li>"), Qt::CaseInsensitive) == 0) {
+                out += QLatin1Char('\n');
+            }
+            p = close;
+            plain = p + 1;
+        } else if (*p == QLatin1Char('&')) {
+            // 解码HTML实体（每处只解码一次，"&amp;lt;"得到"&lt;"）
+            static const struct { const char *entity; int length; char ch; } entities[] = {
+                { "&lt;", 4, '<' }, { "&gt;", 4, '>' }, { "&quot;", 6, '"' },
+                { "&nbsp;", 6, ' ' }, { "&amp;", 5, '&' }
+            };
+            const QStringRef rest(&htmlText, int(p - begin), int(end - p));
+            for (const auto &e : entities) {
+                if (rest.startsWith(QLatin1String(e.entity, e.length))) {
+                    out.append(plain, int(p - plain));
+                    out += QLatin1Char(e.ch);
+                    p += e.length - 1;
+                    plain = p + 1;
+                    break;
+                }
+            }
+        }
+    }
+    out.append(plain, int(end - plain));
+
     // 清理空白
-    return result.trimmed();
+    int first = 0;
+    int last = out.size();
+    while (first < last && out.at(first).isSpace()) ++first;
+    while (last > first && out.at(last - 1).isSpace()) --last;
+    return QString(out.constData() + first, last - first);
 }
 
-// 从排序号推断层次结构
-void ReqifParser::inferHierarchyFromSortNumbers() {
-    QList<ReqData*> validReqs;
-    // 筛选有排序号的有效需求
-    for (auto &req : m_reqMap) {
-        if (req.sortNum > 0 && isValidReq(req)) {
-            validReqs.append(&req);
+// 净化XHTML：仅保留排版标签（表格、列表、强调等），去除其余标签与属性
+// 图片类嵌入对象改为<img src="reqobj:序号">，由渲染时替换为缓存文件
+QString ReqifParser::sanitizeXhtml(const QString &xhtml) {
+    static const QStringList allowedTags = QStringList()
+        << "p" << "br" << "div" << "span" << "b" << "strong" << "i" << "em" << "u" << "s"
+        << "sub" << "sup" << "ul" << "ol" << "li" << "table" << "thead" << "tbody" << "tr"
+        << "td" << "th" << "caption" << "h1" << "h2" << "h3" << "h4" << "h5" << "h6"
+        << "pre" << "code" << "blockquote" << "hr";
+
+    QRegExp tagRx("<(/?)([A-Za-z][A-Za-z0-9]*)([^>]*)>");
+    QRegExp spanRx("(colspan|rowspan)=\"(\\d+)\"");
+    QRegExp dataRx("\\bdata\\s*=\\s*[\"'](reqobj:\\d+)[\"']");
+    QRegExp imageTypeRx("\\btype\\s*=\\s*[\"']image/", Qt::CaseInsensitive);
+
+    QString result;
+    result.reserve(xhtml.size());
+    int pos = 0;
+    int index = 0;
+    while ((index = tagRx.indexIn(xhtml, pos)) != -1) {
+        result += xhtml.midRef(pos, index - pos); // 文本已转义，原样保留
+        pos = index + tagRx.matchedLength();
+
+        const bool closing = !tagRx.cap(1).isEmpty();
+        const QString tag = tagRx.cap(2).toLower();
+        const QString attrs = tagRx.cap(3);
+
+        if (tag == "object") {
+            // 对象标签本身去掉，内部的替代内容保留
+            if (!closing && imageTypeRx.indexIn(attrs) != -1 && dataRx.indexIn(attrs) != -1) {
+                result += QString("<img src=\"%1\"/>").arg(dataRx.cap(1));
+            }
+            continue;
+        }
+        if (!allowedTags.contains(tag)) continue;
+
+        if (tag == "br" || tag == "hr") {
+            if (!closing) result += "<" + tag + "/>";
+        } else if (closing) {
+            result += "</" + tag + ">";
+        } else {
+            result += "<" + tag;
+            if (tag == "td" || tag == "th") {
+                int attrPos = 0;
+                while ((attrPos = spanRx.indexIn(attrs, attrPos)) != -1) {
+                    result += QString(" %1=\"%2\"").arg(spanRx.cap(1), spanRx.cap(2));
+                    attrPos += spanRx.matchedLength();
+                }
+            }
+            result += ">";
         }
     }
-    if (validReqs.isEmpty()) return;
+    result += xhtml.midRef(pos);
+    return result;
+}
 
-    // 按排序号排序
-    std::sort(validReqs.begin(), validReqs.end(),
-              [](ReqData* a, ReqData* b) { return a->sortNum < b->sortNum; });
+// 推断层次结构：章节号按前缀、排序号按位数，排序后单次栈扫描，层级不限
+void ReqifParser::inferHierarchy() {
+    if (m_hierarchyRule == InferNone) return;
 
-    QString lastLevel1, lastLevel2; // 上一级需求ID
-    for (ReqData* req : validReqs) {
-        int num = req->sortNum;
-        // 层级规则：1-9（1级）、10-99（2级）、100+（3级）
-        if (num < 10) {
-            req->level = 1;
-            req->parentId = "";
-            lastLevel1 = req->id;
-            lastLevel2 = "";
-            if (!m_topReqIds.contains(req->id)) {
-                m_topReqIds.append(req->id);
+    bool useOutline = m_hierarchyRule == InferFromOutline;
+    if (m_hierarchyRule == InferAuto) {
+        for (const auto &req : m_reqMap) {
+            if (!req.outlineNum.isEmpty()) {
+                useOutline = true;
+                break;
             }
         }
-        else if (num < 100) {
-            req->level = 2;
-            req->parentId = lastLevel1;
-            lastLevel2 = req->id;
-            m_parentMap[req->id] = lastLevel1;
+    }
+
+    // 筛选有章节号/排序号的有效需求
+    ReqHierarchyInference inference(useOutline ? ReqHierarchyInference::OutlineRule
+                                               : ReqHierarchyInference::SortNumberRule);
+    inference.reserve(m_reqMap.size());
+    QVector<ReqData*> reqs;
+    reqs.reserve(m_reqMap.size());
+    for (auto &req : m_reqMap) {
+        if (!isValidReq(req)) continue;
+        if (useOutline) {
+            if (!inference.addOutline(req.outlineNum)) continue;
+        } else {
+            if (req.sortNum <= 0) continue;
+            inference.addSortNumber(req.sortNum);
         }
-        else {
-            req->level = 3;
-            req->parentId = lastLevel2;
-            m_parentMap[req->id] = lastLevel2;
+        reqs.append(&req);
+    }
+    if (reqs.isEmpty()) return;
+
+    QVector<int> levels;
+    const QVector<int> parents = inference.inferParents(&levels);
+    for (int i = 0; i < reqs.size(); ++i) {
+        ReqData *req = reqs.at(i);
+        req->level = levels.at(i);
+        if (parents.at(i) < 0) {
+            req->parentId.clear();
+        } else {
+            req->parentId = reqs.at(parents.at(i))->id;
+            m_parentMap.insert(req->id, req->parentId);
         }
     }
 }
@@ -340,30 +1424,270 @@ void ReqifParser::updateTopLevelReqs() {
     }
 }
 
-// 计算需求层级（防循环引用）
-int ReqifParser::calculateLevel(const QString &reqId) {
-    if (reqId.isEmpty() || !m_parentMap.contains(reqId)) {
-        return 1;
-    }
-
+// 计算需求层级：父链深度，与树中的深度一致（成环关系已由breakHierarchyCycles断开，visited仅作防护）
+int ReqifParser::calculateLevel(const QString &reqId) const {
     int level = 1;
     QString currentId = reqId;
-    QSet<QString> visited; // 避免循环
+    QSet<QString> visited;
 
     while (m_parentMap.contains(currentId) && !visited.contains(currentId)) {
         visited.insert(currentId);
         level++;
-        currentId = m_parentMap[currentId];
-        if (level > 10) break; // 层级上限保护
+        currentId = m_parentMap.value(currentId);
     }
     return level;
 }
 
-// 判断需求是否有效（非空名称）
+// 断开父链上的环（多个层次结构给出了相互矛盾的父子关系）
+// 从各需求沿父链上行，回到本次上行经过的需求即成环，断开该需求与父需求的关系（起点位于环上时即断开起点）；
+// 父链上游进入环的需求同样得到处理。已确认无环的父链不重复上行；断开后不再成环，延迟加载再次处理时不重复报告
+QHash<QString, QString> ReqifParser::breakHierarchyCycles(const QStringList &reqIds) {
+    QHash<QString, QString> broken;
+    QSet<QString> acyclic;
+    foreach (const QString &reqId, reqIds) {
+        QSet<QString> path;
+        QString currentId = reqId;
+        while (!acyclic.contains(currentId) && m_parentMap.contains(currentId)) {
+            if (path.contains(currentId)) {
+                const QString parentId = m_parentMap.take(currentId);
+                ReqDiagnostic diagnostic;
+                diagnostic.kind = ReqDiagnostic::HierarchyCycle;
+                diagnostic.reqId = currentId;
+                diagnostic.detail = parentId;
+                addDiagnostic(diagnostic);
+                auto it = m_reqMap.find(currentId);
+                if (it != m_reqMap.end()) it->parentId.clear();
+                broken.insert(currentId, parentId);
+                break;
+            }
+            path.insert(currentId);
+            currentId = m_parentMap.value(currentId);
+        }
+        acyclic.unite(path);
+    }
+    return broken;
+}
+
+// 构建父->子索引（与fillTree的挂载规则一致）
+void ReqifParser::buildChildMap() {
+    m_childMap.clear();
+    for (const auto &req : m_reqMap) {
+        if (!req.parentId.isEmpty()) {
+            m_childMap[req.parentId].append(req.id);
+        }
+    }
+}
+
+// 构建文本检索索引（名称和描述仅在加载时折叠一次大小写）
+void ReqifParser::buildTextIndex() {
+    m_textIndex.clear();
+    m_textIndex.setStringPool(m_stringPool);
+    m_textIndex.reserve(m_reqMap.size());
+    for (const auto &req : m_reqMap) {
+        m_textIndex.add(req.id, req.name, req.description);
+    }
+}
+
+// 记录错误信息，交互模式下弹窗提示
+void ReqifParser::reportError(const QString &title, const QString &message) {
+    m_errorString = message;
+    if (m_interactive) {
+        QMessageBox::critical(nullptr, title, message);
+    } else {
+        qWarning() << title << message;
+    }
+}
+
+// 记录完整性诊断；严格模式下经xml中止解析（解析结束后判定的由failOnDiagnostics报告）
+void ReqifParser::addDiagnostic(const ReqDiagnostic &diagnostic, QXmlStreamReader *xml) {
+    if (m_diagnostics.size() < MaxDiagnostics) {
+        m_diagnostics.append(diagnostic);
+    }
+    ++m_diagnosticTotal;
+    if (m_strict && xml && !xml->hasError()) {
+        xml->raiseError(diagnostic.toString());
+    }
+}
+
+// 检查属性值引用的属性定义：定义区已结束时立即判定，否则文档结束时复核
+void ReqifParser::checkAttributeDefinition(QXmlStreamReader &xml, const QString &defRef, const QString &reqId) {
+    const QString ref = defRef.trimmed();
+    if (ref.isEmpty() || m_integrity.attributeDefs.contains(ref)) return;
+
+    ReqDiagnostic diagnostic;
+    diagnostic.kind = ReqDiagnostic::UnknownAttribute;
+    diagnostic.reqId = reqId;
+    diagnostic.detail = ref;
+    diagnostic.line = sourceLine(xml.lineNumber());
+    if (m_integrity.typesClosed) {
+        addDiagnostic(diagnostic, &xml);
+    } else {
+        m_integrity.pending.append(diagnostic);
+    }
+}
+
+// 严格模式下有诊断时报告失败（报告第一条及总数）
+bool ReqifParser::failOnDiagnostics() {
+    if (!m_strict || m_diagnosticTotal == 0) return true;
+    reportError(u8"解析失败", QString(u8"完整性检查失败（严格模式）：%1\n共 %2 个问题")
+                              .arg(m_diagnostics.first().toString()).arg(m_diagnosticTotal));
+    return false;
+}
+
+// 需求对象是否已解析
+bool ReqifParser::isKnownReq(const QString &reqId) const {
+    return m_indexBuilder ? m_indexBuilder->contains(reqId) : m_reqMap.contains(reqId);
+}
+
+// 需求内容指纹（层次关系单独比较）
+QByteArray ReqifParser::reqFingerprint(const ReqData &req) {
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(reinterpret_cast<const char *>(req.name.constData()), req.name.size() * int(sizeof(QChar)));
+    hash.addData("\0", 1);
+    hash.addData(reinterpret_cast<const char *>(req.description.constData()),
+                 req.description.size() * int(sizeof(QChar)));
+    hash.addData(reinterpret_cast<const char *>(req.richDescription.constData()),
+                 req.richDescription.size() * int(sizeof(QChar)));
+    hash.addData(reinterpret_cast<const char *>(&req.sortNum), sizeof(req.sortNum));
+    return hash.result();
+}
+
+// 判断需求是否有效（后处理时已按classifyReq分类）
 bool ReqifParser::isValidReq(const ReqData &req) const {
+    return req.valid;
+}
+
+// 有效性分类规则：非空名称
+bool ReqifParser::classifyReq(const ReqData &req) {
     return !req.name.isEmpty() && !req.name.contains(u8"未命名需求", Qt::CaseInsensitive);
 }
 
+// 并行后处理：按线程数分块，每块一个清理缓冲与局部统计，结束后在当前线程合并
+// 各块只写入自己的记录，需求存储的结构在处理期间不变
+void ReqifParser::postProcess(QVector<RawReqText> &pending) {
+    if (pending.isEmpty()) return;
+
+    struct Chunk {
+        RawReqText *begin;
+        RawReqText *end;
+        ReqStatistics stats;
+    };
+    const int chunkCount = qMax(1, QThread::idealThreadCount()) * 4; // 多分几块，均衡描述长短不一的负载
+    const int chunkSize = (pending.size() + chunkCount - 1) / chunkCount;
+    QVector<Chunk> chunks;
+    RawReqText *data = pending.data();
+    for (int begin = 0; begin < pending.size(); begin += chunkSize) {
+        Chunk chunk;
+        chunk.begin = data + begin;
+        chunk.end = data + qMin(begin + chunkSize, pending.size());
+        chunks.append(chunk);
+    }
+
+    const bool keepRichText = m_keepRichText;
+    ReqStringPool *pool = m_stringPool;
+    QtConcurrent::blockingMap(chunks, [keepRichText, pool](Chunk &chunk) {
+        QString scratch;
+        for (RawReqText *raw = chunk.begin; raw != chunk.end; ++raw) {
+            processReq(*raw, keepRichText, pool, scratch, chunk.stats);
+        }
+    });
+    for (const Chunk &chunk : chunks) {
+        m_stats.add(chunk.stats);
+    }
+}
+
+// 后处理一批并清空（保留容量供下一批复用）
+// 重复ID的记录只保留最后一次出现的原始文本，避免并行处理同一记录
+void ReqifParser::flushPending(QVector<RawReqText> &pending, bool duplicates) {
+    if (duplicates) {
+        QSet<const ReqData *> seen;
+        QVector<RawReqText> unique;
+        unique.reserve(pending.size());
+        for (int i = pending.size() - 1; i >= 0; --i) {
+            if (seen.contains(pending.at(i).req)) continue;
+            seen.insert(pending.at(i).req);
+            unique.append(std::move(pending[i]));
+        }
+        std::reverse(unique.begin(), unique.end());
+        pending.swap(unique);
+    }
+    postProcess(pending);
+
+    // 边解析边检查预算：一旦超出即转为卸载模式，已读入和之后读入的描述都不再保留
+    if (!m_descriptionsOffloaded && m_memoryBudget > 0) {
+        const qint64 total = memoryUsage().total();
+        if (total > m_memoryBudget) {
+            qWarning() << u8"解析中超出内存预算，描述改为按需从源文件读取 |" << m_filePath
+                       << u8"估算：" << total / (1024 * 1024) << u8"MB 预算：" << m_memoryBudget / (1024 * 1024) << u8"MB";
+            for (auto &req : m_reqMap) {
+                dropDescription(req);
+            }
+            m_stats.descriptionChars = 0;
+            m_stats.richTextChars = 0;
+            m_descriptionsOffloaded = true; // 解析结束后由enforceMemoryBudget建立字节区间
+        }
+    } else if (m_descriptionsOffloaded) {
+        for (RawReqText &raw : pending) {
+            dropDescription(*raw.req);
+        }
+        m_stats.descriptionChars = 0;
+        m_stats.richTextChars = 0;
+    }
+    pending.resize(0);
+}
+
+// 后处理单条需求：清理名称/描述、净化富文本、驻留、分类并计入统计
+void ReqifParser::processReq(RawReqText &raw, bool keepRichText, ReqStringPool *pool,
+                             QString &scratch, ReqStatistics &stats) {
+    ReqData &req = *raw.req;
+    if (raw.hasName) {
+        req.name = cleanHtml(raw.name, scratch);
+    }
+    if (raw.hasDescription) {
+        req.description = cleanHtml(raw.description, scratch);
+        if (keepRichText) {
+            req.richDescription = sanitizeXhtml(raw.description);
+        }
+    }
+    raw.name.clear(); // 原始文本处理完即释放
+    raw.description.clear();
+    if (pool) {
+        // 多个基线间相同的名称/描述共享一份数据
+        req.name = pool->intern(req.name);
+        req.description = pool->intern(req.description);
+    }
+    req.valid = classifyReq(req);
+    stats.add(req);
+}
+
+// 计入一条需求
+void ReqStatistics::add(const ReqData &req) {
+    if (req.valid) ++valid;
+    if (!req.description.isEmpty()) ++described;
+    idChars += req.id.size();
+    nameChars += req.name.size() + req.outlineNum.size();
+    descriptionChars += req.description.size();
+    richTextChars += req.richDescription.size();
+}
+
+void ReqStatistics::remove(const ReqData &req) {
+    if (req.valid) --valid;
+    if (!req.description.isEmpty()) --described;
+    idChars -= req.id.size();
+    nameChars -= req.name.size() + req.outlineNum.size();
+    descriptionChars -= req.description.size();
+    richTextChars -= req.richDescription.size();
+}
+
+void ReqStatistics::add(const ReqStatistics &other) {
+    valid += other.valid;
+    described += other.described;
+    idChars += other.idChars;
+    nameChars += other.nameChars;
+    descriptionChars += other.descriptionChars;
+    richTextChars += other.richTextChars;
+}
+
 // 填充需求树到UI
 void ReqifParser::fillTree(QTreeWidget *treeWidget) {
     if (!treeWidget) return;
@@ -377,17 +1701,46 @@ void ReqifParser::fillTree(QTreeWidget *treeWidget) {
     // 设置树控件的缩进值（替代原setIndentation方法）
     treeWidget->setIndentation(20); // 统一设置所有层级的基础缩进
 
+    fillTreeItems(treeWidget->invisibleRootItem());
+
+    // 优化显示（超大文件模式的节点展开时才填充，保持折叠）
+    if (!m_diskIndex) treeWidget->expandAll();
+    treeWidget->resizeColumnToContents(0);
+    treeWidget->resizeColumnToContents(1);
+}
+
+// 在指定节点下填充需求（顶层需求挂到该节点）
+// 多个规格或延迟加载时先列出规格节点，需求挂在所属规格下
+void ReqifParser::fillTreeItems(QTreeWidgetItem *rootItem) {
+    if (!rootItem) return;
+
+    if (m_diskIndex) {
+        addIndexItems(rootItem, m_diskIndex->firstRoot());
+        return;
+    }
+
+    if (m_lazyLoading || m_specs.size() > 1) {
+        QSet<QString> visited;
+        for (const auto &spec : m_specs) {
+            QTreeWidgetItem *specItem = createSpecificationItem(spec);
+            rootItem->addChild(specItem);
+            foreach (const QString &reqId, spec.rootIds) {
+                addSubtreeItems(specItem, reqId, visited);
+            }
+        }
+        // 未被任何规格引用的顶层需求直接挂在根节点下
+        foreach (const QString &reqId, m_topReqIds) {
+            addSubtreeItems(rootItem, reqId, visited);
+        }
+        return;
+    }
+
     QMap<QString, QTreeWidgetItem*> itemMap; // 需求ID->树节点映射
 
     // 1. 创建所有有效需求节点
     for (const auto &req : m_reqMap) {
         if (!isValidReq(req)) continue;
-
-        QTreeWidgetItem *item = new QTreeWidgetItem();
-        item->setText(0, req.sortNum > 0 ? QString::number(req.sortNum) : "");
-        item->setText(1, req.name);
-        item->setData(0, Qt::UserRole, req.id); // 存储需求ID
-        itemMap[req.id] = item;
+        itemMap[req.id] = createTreeItem(req);
     }
 
     // 2. 构建层次结构
@@ -397,46 +1750,669 @@ void ReqifParser::fillTree(QTreeWidget *treeWidget) {
         QTreeWidgetItem *item = itemMap[req.id];
         // 无父节点->顶层；有父节点->子节点
         if (req.parentId.isEmpty() || !itemMap.contains(req.parentId)) {
-            treeWidget->addTopLevelItem(item);
+            rootItem->addChild(item);
         }
         else {
             itemMap[req.parentId]->addChild(item);
         }
     }
+}
 
-    // 3. 优化显示
-    treeWidget->expandAll();
-    treeWidget->resizeColumnToContents(0);
-    treeWidget->resizeColumnToContents(1);
+// 按父->子索引添加子树（无效需求不建节点，其子需求挂到上一级；visited防循环及重复）
+void ReqifParser::addSubtreeItems(QTreeWidgetItem *parentItem, const QString &reqId, QSet<QString> &visited) const {
+    auto it = m_reqMap.constFind(reqId);
+    if (it == m_reqMap.constEnd() || visited.contains(reqId)) return;
+    visited.insert(reqId);
+
+    QTreeWidgetItem *item = parentItem;
+    if (isValidReq(*it)) {
+        item = createTreeItem(*it);
+        parentItem->addChild(item);
+    }
+    foreach (const QString &childId, m_childMap.value(reqId)) {
+        addSubtreeItems(item, childId, visited);
+    }
+}
+
+// 创建规格节点（未加载的规格显示展开标记，展开时再加载）
+QTreeWidgetItem *ReqifParser::createSpecificationItem(const ReqSpecification &spec) const {
+    QTreeWidgetItem *item = new QTreeWidgetItem();
+    item->setText(1, spec.name.isEmpty() ? spec.id : spec.name);
+    item->setData(0, SpecificationRole, spec.id);
+    QFont font = item->font(1);
+    font.setItalic(true);
+    item->setFont(1, font);
+    if (!spec.loaded) {
+        item->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+    }
+    return item;
+}
+
+// 加载并填充规格节点
+bool ReqifParser::fillSpecificationItem(QTreeWidgetItem *specItem) {
+    if (!specItem || specItem->childCount() > 0) return true;
+    const QString specId = specItem->data(0, SpecificationRole).toString();
+    if (!loadSpecification(specId)) return false;
+
+    QSet<QString> visited;
+    for (const auto &spec : m_specs) {
+        if (spec.id != specId) continue;
+        foreach (const QString &reqId, spec.rootIds) {
+            addSubtreeItems(specItem, reqId, visited);
+        }
+    }
+    specItem->setChildIndicatorPolicy(QTreeWidgetItem::DontShowIndicatorWhenChildless);
+    return true;
+}
+
+// 超大文件模式：展开需求节点时填充第一批子节点；点击"加载更多"时以下一批替换该节点
+bool ReqifParser::fillIndexItem(QTreeWidgetItem *item) {
+    if (!m_diskIndex || !item) return false;
+
+    const QVariant next = item->data(0, IndexContinueRole);
+    if (next.isValid()) {
+        QTreeWidgetItem *parentItem = item->parent() ? item->parent() : item->treeWidget()->invisibleRootItem();
+        parentItem->removeChild(item);
+        delete item;
+        addIndexItems(parentItem, next.toInt());
+        return true;
+    }
+    const QVariant record = item->data(0, IndexRecordRole);
+    if (!record.isValid() || item->childCount() > 0) return true;
+    addIndexItems(item, m_diskIndex->firstChild(record.toInt()));
+    item->setChildIndicatorPolicy(QTreeWidgetItem::DontShowIndicatorWhenChildless);
+    return true;
+}
+
+// 从first起按批添加兄弟节点，剩余部分以"加载更多"节点代替
+// 无效需求不建节点，其子需求挂到上一级（与内存模式一致）
+void ReqifParser::addIndexItems(QTreeWidgetItem *parentItem, int first) const {
+    const int batchSize = 1000;
+    int added = 0;
+    int index = first;
+    for (; index >= 0 && added < batchSize; index = m_diskIndex->nextSibling(index)) {
+        if (!m_diskIndex->isLive(index)) continue;
+        if (!m_diskIndex->isValid(index)) {
+            addIndexItems(parentItem, m_diskIndex->firstChild(index));
+            continue;
+        }
+        parentItem->addChild(createIndexItem(index));
+        ++added;
+    }
+    if (index >= 0) {
+        QTreeWidgetItem *moreItem = new QTreeWidgetItem();
+        moreItem->setText(1, u8"……（点击加载更多）");
+        moreItem->setData(0, IndexContinueRole, index);
+        parentItem->addChild(moreItem);
+    }
+}
+
+// 由索引记录创建需求树节点（有子需求时显示展开标记，展开时再填充）
+QTreeWidgetItem *ReqifParser::createIndexItem(int index) const {
+    QTreeWidgetItem *item = createTreeItem(m_diskIndex->record(index));
+    item->setData(0, IndexRecordRole, index);
+    if (m_diskIndex->firstChild(index) >= 0) {
+        item->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+    }
+    return item;
+}
+
+// 创建需求树节点
+QTreeWidgetItem *ReqifParser::createTreeItem(const ReqData &req) const {
+    QTreeWidgetItem *item = new QTreeWidgetItem();
+    item->setText(0, req.sortNum > 0 ? QString::number(req.sortNum) : "");
+    item->setText(1, req.name);
+    item->setData(0, Qt::UserRole, req.id); // 存储需求ID
+    return item;
+}
+
+// 按差异局部更新需求树（保留展开、选中状态）
+void ReqifParser::updateTree(QTreeWidget *treeWidget, const ReqChangeSet &changes) {
+    if (!treeWidget) return;
+    updateTreeItems(treeWidget->invisibleRootItem(), changes);
+}
+
+// 按差异局部更新指定节点下的需求
+void ReqifParser::updateTreeItems(QTreeWidgetItem *rootItem, const ReqChangeSet &changes) {
+    if (!rootItem || m_diskIndex) return;
+
+    QHash<QString, QTreeWidgetItem*> itemMap;
+    QList<QTreeWidgetItem*> pending;
+    for (int i = 0; i < rootItem->childCount(); ++i) pending.append(rootItem->child(i));
+    while (!pending.isEmpty()) {
+        QTreeWidgetItem *item = pending.takeLast();
+        const QString reqId = item->data(0, Qt::UserRole).toString();
+        if (!reqId.isEmpty()) itemMap.insert(reqId, item);
+        for (int i = 0; i < item->childCount(); ++i) pending.append(item->child(i));
+    }
+
+    // 规格分组时（与fillTreeItems一致）顶层需求挂在所属规格节点下，无效需求的子需求挂在其上一级
+    const bool bySpec = m_lazyLoading || m_specs.size() > 1;
+    QHash<QString, QTreeWidgetItem*> specItems; // 规格ID -> 规格节点
+    QHash<QString, QString> rootSpecs;          // 规格根需求ID -> 规格ID
+    if (bySpec) {
+        for (int i = 0; i < rootItem->childCount(); ++i) {
+            const QString specId = rootItem->child(i)->data(0, SpecificationRole).toString();
+            if (!specId.isEmpty()) specItems.insert(specId, rootItem->child(i));
+        }
+        for (const auto &spec : m_specs) {
+            foreach (const QString &reqId, spec.rootIds) {
+                if (!rootSpecs.contains(reqId)) rootSpecs.insert(reqId, spec.id);
+            }
+        }
+    }
+
+    auto parentOf = [rootItem](QTreeWidgetItem *item) {
+        return item->parent() ? item->parent() : rootItem;
+    };
+    // 节点应挂载的位置：父需求节点；父需求没有节点时，分组模式下沿父链向上找，直至所属规格节点
+    auto containerFor = [&](const QString &reqId) -> QTreeWidgetItem* {
+        QString top = reqId;
+        QString current = m_reqMap.value(reqId).parentId;
+        QSet<QString> seen;
+        while (!current.isEmpty() && !seen.contains(current)) {
+            if (QTreeWidgetItem *item = itemMap.value(current)) return item;
+            if (!bySpec) return rootItem;
+            seen.insert(current);
+            top = current;
+            current = m_reqMap.value(current).parentId;
+        }
+        QTreeWidgetItem *specItem = bySpec ? specItems.value(rootSpecs.value(top)) : nullptr;
+        return specItem ? specItem : rootItem;
+    };
+    // 从树中摘下节点（子节点提升到上一级或根节点，与填充时父节点缺失的规则一致）
+    auto detach = [rootItem, bySpec, parentOf](QTreeWidgetItem *item) {
+        QTreeWidgetItem *target = bySpec ? parentOf(item) : rootItem;
+        const QList<QTreeWidgetItem*> children = item->takeChildren();
+        target->addChildren(children);
+        parentOf(item)->removeChild(item);
+    };
+
+    QStringList toAttach;
+    // 1. 删除节点
+    foreach (const QString &reqId, changes.removed) {
+        QTreeWidgetItem *item = itemMap.take(reqId);
+        if (!item) continue;
+        detach(item);
+        delete item;
+    }
+    // 2. 内容变化：更新文字，有效性变化时增删节点
+    foreach (const QString &reqId, changes.changed) {
+        const ReqData req = m_reqMap.value(reqId);
+        QTreeWidgetItem *item = itemMap.value(reqId);
+        if (item && !isValidReq(req)) {
+            itemMap.remove(reqId);
+            detach(item);
+            delete item;
+        } else if (item) {
+            item->setText(0, req.sortNum > 0 ? QString::number(req.sortNum) : "");
+            item->setText(1, req.name);
+        } else if (isValidReq(req)) {
+            itemMap.insert(reqId, createTreeItem(req));
+            toAttach.append(reqId);
+        }
+    }
+    // 3. 父节点变化：先摘下，稍后重新挂载
+    foreach (const QString &reqId, changes.moved) {
+        QTreeWidgetItem *item = itemMap.value(reqId);
+        if (!item || toAttach.contains(reqId)) continue;
+        parentOf(item)->removeChild(item);
+        toAttach.append(reqId);
+    }
+    // 4. 新增节点
+    foreach (const QString &reqId, changes.added) {
+        const ReqData req = m_reqMap.value(reqId);
+        if (!isValidReq(req)) continue;
+        itemMap.insert(reqId, createTreeItem(req));
+        toAttach.append(reqId);
+    }
+    // 5. 挂载到新的父节点
+    foreach (const QString &reqId, toAttach) {
+        containerFor(reqId)->addChild(itemMap.value(reqId));
+    }
+    // 6. 之前因该节点缺失（无效或不存在）而被提升的子需求移回其下；无效子需求没有节点，继续向下找
+    foreach (const QString &reqId, toAttach) {
+        QTreeWidgetItem *item = itemMap.value(reqId);
+        QStringList childIds = m_childMap.value(reqId);
+        QSet<QString> seen;
+        while (!childIds.isEmpty()) {
+            const QString childId = childIds.takeFirst();
+            if (seen.contains(childId)) continue;
+            seen.insert(childId);
+            QTreeWidgetItem *child = itemMap.value(childId);
+            if (child) {
+                bool ancestor = false; // 成环的关系不移动，避免节点挂到自己的子树下
+                for (QTreeWidgetItem *p = item; p && !ancestor; p = p->parent()) ancestor = p == child;
+                if (!ancestor && child->parent() != item) {
+                    parentOf(child)->removeChild(child);
+                    item->addChild(child);
+                }
+            } else if (bySpec) {
+                childIds += m_childMap.value(childId);
+            }
+        }
+    }
 }
 
 // 获取需求描述
 QString ReqifParser::getReqDescription(const QString &reqId) {
+    if (m_diskIndex) {
+        const int index = m_diskIndex->find(reqId);
+        if (index == ReqDiskIndex::NoRecord) return u8"[未找到该需求]";
+        const QString description = m_diskIndex->description(index);
+        return description.isEmpty() ? u8"[暂无详细描述]" : description;
+    }
     if (m_reqMap.contains(reqId)) {
-        QString desc = m_reqMap[reqId].description;
-        return desc.isEmpty() ? u8"[暂无详细描述]" : desc;
+        ReqData req = m_reqMap.value(reqId);
+        if (m_descriptionsOffloaded && !readOffloadedText(req)) {
+            return u8"[描述读取失败，源文件可能已变化]";
+        }
+        return req.description.isEmpty() ? u8"[暂无详细描述]" : req.description;
     }
     return u8"[未找到该需求]";
 }
 
+// 根据ID获取需求
+bool ReqifParser::getReq(const QString &reqId, ReqData &req) const {
+    if (m_diskIndex) {
+        const int index = m_diskIndex->find(reqId);
+        if (index == ReqDiskIndex::NoRecord) return false;
+        req = m_diskIndex->record(index);
+        req.description = m_diskIndex->description(index);
+        req.richDescription = m_diskIndex->richDescription(index);
+        return true;
+    }
+    auto it = m_reqMap.constFind(reqId);
+    if (it == m_reqMap.constEnd()) return false;
+    req = it.value();
+    if (m_descriptionsOffloaded) readOffloadedText(req);
+    return true;
+}
+
+// 获取顶层需求ID列表
+QStringList ReqifParser::getTopReqIds() const {
+    if (m_diskIndex) {
+        QStringList ids;
+        for (int i = m_diskIndex->firstRoot(); i >= 0; i = m_diskIndex->nextSibling(i)) {
+            if (m_diskIndex->isLive(i) && m_diskIndex->isValid(i)) ids.append(m_diskIndex->id(i));
+        }
+        return ids;
+    }
+    return m_topReqIds;
+}
+
+// 获取直接子需求ID列表
+QStringList ReqifParser::getChildIds(const QString &parentId) const {
+    if (m_diskIndex) {
+        QStringList ids;
+        const int parent = m_diskIndex->find(parentId);
+        if (parent == ReqDiskIndex::NoRecord) return ids;
+        for (int i = m_diskIndex->firstChild(parent); i >= 0; i = m_diskIndex->nextSibling(i)) {
+            if (m_diskIndex->isLive(i)) ids.append(m_diskIndex->id(i));
+        }
+        return ids;
+    }
+    return m_childMap.value(parentId);
+}
+
+// 当前加载的文件路径
+QString ReqifParser::filePath() const {
+    return m_filePath;
+}
+
+// ReqIF命名空间
+QString ReqifParser::reqifNamespace() const {
+    return m_reqifNamespace;
+}
+
+// 根元素上的命名空间声明
+QXmlStreamNamespaceDeclarations ReqifParser::namespaceDeclarations() const {
+    return m_namespaceDecls;
+}
+
+// 最近一次加载失败的原因
+QString ReqifParser::errorString() const {
+    return m_errorString;
+}
+
+// 设置是否弹窗提示错误
+void ReqifParser::setInteractive(bool interactive) {
+    m_interactive = interactive;
+}
+
+// 共享字符串驻留池
+void ReqifParser::setStringPool(ReqStringPool *pool) {
+    m_stringPool = pool;
+}
+
+// 经驻留池去重（构建磁盘索引时字符串不常驻，不驻留）
+QString ReqifParser::intern(const QString &text) const {
+    return m_stringPool && !m_indexBuilder ? m_stringPool->intern(text) : text;
+}
+
+// 不区分大小写检索需求，返回匹配的需求ID
+QStringList ReqifParser::findReqs(const QString &text, bool includeDescription) const {
+    int fields = ReqTextSearch::NameField;
+    if (includeDescription) fields |= ReqTextSearch::DescriptionField;
+
+    QStringList ids;
+    if (m_diskIndex) {
+        foreach (int index, m_diskIndex->search(text, fields)) {
+            ids.append(m_diskIndex->id(index));
+        }
+        return ids;
+    }
+    foreach (ReqTextSearch::Handle handle, m_textIndex.find(text, fields)) {
+        ids.append(m_textIndex.idAt(handle));
+    }
+    return ids;
+}
+
+// 获取文本检索索引
+const ReqTextSearch &ReqifParser::textIndex() const {
+    return m_textIndex;
+}
+
+// 根据ID获取富文本描述
+QString ReqifParser::getReqRichDescription(const QString &reqId) const {
+    if (m_diskIndex) {
+        const int index = m_diskIndex->find(reqId);
+        return index == ReqDiskIndex::NoRecord ? QString() : m_diskIndex->richDescription(index);
+    }
+    ReqData req = m_reqMap.value(reqId);
+    if (m_descriptionsOffloaded && m_keepRichText) readOffloadedText(req);
+    return req.richDescription;
+}
+
+// 解析时是否保留富文本描述
+void ReqifParser::setKeepRichText(bool keep) {
+    m_keepRichText = keep;
+}
+
+bool ReqifParser::keepRichText() const {
+    return m_keepRichText;
+}
+
+// 是否按规格延迟加载
+void ReqifParser::setLazyLoading(bool lazy) {
+    m_lazyLoading = lazy;
+}
+
+bool ReqifParser::lazyLoading() const {
+    return m_lazyLoading;
+}
+
+// 层次推断规则
+void ReqifParser::setHierarchyRule(HierarchyRule rule) {
+    m_hierarchyRule = rule;
+}
+
+ReqifParser::HierarchyRule ReqifParser::hierarchyRule() const {
+    return m_hierarchyRule;
+}
+
+// 章节号属性
+void ReqifParser::setOutlineAttribute(const QString &defRefKey) {
+    m_outlineAttribute = defRefKey;
+}
+
+// 文档中的规格
+QList<ReqSpecification> ReqifParser::specifications() const {
+    return m_specs;
+}
+
 // 获取总需求数
 int ReqifParser::getAllReqCount() const {
-    return m_reqMap.size();
+    return m_diskIndex ? m_diskIndex->reqCount() : m_reqMap.size();
 }
 
 // 获取有效需求数
 int ReqifParser::getValidReqCount() const {
-    int count = 0;
-    for (const auto &req : m_reqMap) {
-        if (isValidReq(req)) count++;
+    return m_stats.valid;
+}
+
+// 需求统计（解析后处理时汇总，重新加载时替换）
+ReqStatistics ReqifParser::statistics() const {
+    return m_stats;
+}
+
+namespace {
+
+const qint64 HeapOverhead = 16; // 每次堆分配的管理开销（估算）
+
+// count个字符串（共chars个字符）的占用：数据头、终止符与分配开销
+qint64 stringBytes(qint64 count, qint64 chars) {
+    return count * qint64(sizeof(QArrayData) + HeapOverhead) + (chars + count) * qint64(sizeof(QChar));
+}
+
+// count个QMap节点（左右子节点、父节点与颜色，另加键值）
+qint64 mapNodeBytes(qint64 count, qint64 payload) {
+    return count * (3 * qint64(sizeof(void *)) + payload + HeapOverhead);
+}
+
+} // namespace
+
+// 内存占用估算：由缓存的字符数统计和容器大小计算，不遍历需求
+ReqMemoryUsage ReqifParser::memoryUsage() const {
+    const qint64 count = m_reqMap.size();
+    ReqMemoryUsage usage;
+    if (m_diskIndex) {
+        usage.records = m_diskIndex->mappedBytes(); // 超大文件模式只有映射的索引页（由系统按需换入换出）
+        return usage;
+    }
+    usage.records = mapNodeBytes(count, sizeof(QString) + sizeof(ReqData));
+    usage.ids = stringBytes(count, m_stats.idChars);
+    usage.names = stringBytes(count, m_stats.nameChars);
+    if (m_descriptionsOffloaded) {
+        usage.descriptions = qint64(m_specObjectRanges.size()) * qint64(sizeof(QString) + sizeof(ReqifByteRange) + HeapOverhead);
+    } else {
+        const qint64 strings = qint64(m_stats.described) * (m_keepRichText ? 2 : 1);
+        usage.descriptions = stringBytes(strings, m_stats.descriptionChars + m_stats.richTextChars);
+    }
+    usage.hierarchy = mapNodeBytes(m_parentMap.size(), 2 * sizeof(QString))
+                    + mapNodeBytes(m_childMap.size(), sizeof(QString) + sizeof(QStringList))
+                    + qint64(m_parentMap.size() + m_topReqIds.size()) * qint64(sizeof(void *));
+    usage.textIndex = m_textIndex.memoryBytes();
+    return usage;
+}
+
+// 内存预算（下次加载生效；0为不限）
+void ReqifParser::setMemoryBudget(qint64 bytes) {
+    m_memoryBudget = qMax<qint64>(0, bytes);
+}
+
+qint64 ReqifParser::memoryBudget() const {
+    return m_memoryBudget;
+}
+
+bool ReqifParser::descriptionsOffloaded() const {
+    return m_descriptionsOffloaded;
+}
+
+// 超大文件模式（下次加载生效）
+void ReqifParser::setOutOfCore(bool enabled) {
+    m_outOfCore = enabled;
+}
+
+bool ReqifParser::outOfCore() const {
+    return m_outOfCore;
+}
+
+// 严格模式（下次加载生效）
+void ReqifParser::setStrict(bool strict) {
+    m_strict = strict;
+}
+
+bool ReqifParser::strict() const {
+    return m_strict;
+}
+
+// 最近一次加载的完整性诊断
+QVector<ReqDiagnostic> ReqifParser::diagnostics() const {
+    return m_diagnostics;
+}
+
+int ReqifParser::diagnosticCount() const {
+    return m_diagnosticTotal;
+}
+
+// 类别标识（报告中作为稳定的机器可读字段）
+QString ReqDiagnostic::kindName() const {
+    switch (kind) {
+    case EmptyIdentifier: return "empty-identifier";
+    case DuplicateId: return "duplicate-id";
+    case DanglingReference: return "dangling-reference";
+    case HierarchyCycle: return "hierarchy-cycle";
+    case UnknownAttribute: return "unknown-attribute";
+    }
+    return QString();
+}
+
+QString ReqDiagnostic::toString() const {
+    QString text;
+    switch (kind) {
+    case EmptyIdentifier:
+        text = u8"需求对象缺少IDENTIFIER，已丢弃";
+        break;
+    case DuplicateId:
+        text = QString(u8"重复的需求ID %1，后出现的覆盖先出现的").arg(reqId);
+        break;
+    case DanglingReference:
+        text = QString(u8"层次引用的需求对象 %1 不存在").arg(reqId);
+        break;
+    case HierarchyCycle:
+        text = QString(u8"需求 %1 与父需求 %2 构成层次环，已忽略").arg(reqId, detail);
+        break;
+    case UnknownAttribute:
+        text = QString(u8"需求 %1 引用了未定义的属性定义 %2").arg(reqId, detail);
+        break;
+    }
+    return line > 0 ? QString(u8"第%1行：%2").arg(line).arg(text) : text;
+}
+
+// 超出预算时卸载描述；已卸载时（延迟加载新规格后）新读入的描述已在分批后处理时释放
+void ReqifParser::enforceMemoryBudget() {
+    if (m_descriptionsOffloaded && m_offloadRaw.isOpen()) return;
+    if (!m_descriptionsOffloaded) {
+        if (m_memoryBudget <= 0) return;
+        const qint64 total = memoryUsage().total();
+        if (total <= m_memoryBudget) return;
+        qWarning() << u8"超出内存预算，描述改为按需从源文件读取 |" << m_filePath
+                   << u8"估算：" << total / (1024 * 1024) << u8"MB 预算：" << m_memoryBudget / (1024 * 1024) << u8"MB";
+    }
+    offloadDescriptions();
+}
+
+// 卸载描述：源文件即为溢出存储，只保留SPEC-OBJECT字节区间，查看或导出时按需读回
+bool ReqifParser::offloadDescriptions() {
+    // 1. 字节区间只对解析时的文件版本有效
+    const QFileInfo info(m_filePath);
+    if (m_filePath.isEmpty() || info.size() != m_indexedSize || info.lastModified() != m_indexedTime) {
+        qWarning() << u8"文件已变化，无法卸载描述：" << m_filePath;
+        return false;
+    }
+    // 卸载期间保持映射，按需读回时不再逐次打开（重新加载后文件版本变化，重新映射）
+    m_offloadRaw.close();
+    if (!m_offloadRaw.openUtf8(m_filePath)) {
+        qWarning() << u8"无法读取文件，保留描述：" << m_offloadRaw.errorString();
+        return false;
+    }
+    if (m_specObjectRanges.isEmpty()) {
+        m_specObjectRanges = m_offloadRaw.indexElements("SPEC-OBJECT", m_offloadRaw.whole());
+    }
+    captureScopeDeclarations(m_offloadRaw);
+
+    // 2. 释放描述文本（先补齐指纹，重新加载时仍按完整内容比较；检索索引随之只含名称）
+    for (auto &req : m_reqMap) {
+        dropDescription(req);
+    }
+    m_stats.descriptionChars = 0;
+    m_stats.richTextChars = 0;
+    m_descriptionsOffloaded = true;
+    buildTextIndex();
+    if (m_stringPool) {
+        m_stringPool->prune();
+    }
+    return true;
+}
+
+// 记录指纹后释放描述（解析中超出预算时逐批调用，已记录的指纹不重复计算）
+void ReqifParser::dropDescription(ReqData &req) {
+    if (!m_fingerprints.contains(req.id)) {
+        m_fingerprints.insert(req.id, reqFingerprint(req));
     }
-    return count;
+    req.description = QString();
+    req.richDescription = QString();
+}
+
+// 从源文件读回单条需求的描述：按字节区间取出SPEC-OBJECT，只读取其中的XHTML属性值
+// 不建立需求存储、层次与检索索引；名称中的嵌入对象同样计入序号，与解析时一致
+bool ReqifParser::readOffloadedText(ReqData &req) const {
+    if (req.id == m_lastOffloaded.id && !req.id.isEmpty()) {
+        req.description = m_lastOffloaded.description;
+        req.richDescription = m_lastOffloaded.richDescription;
+        return true;
+    }
+    const ReqifByteRange object = m_specObjectRanges.value(req.id);
+    const QFileInfo info(m_filePath);
+    if (!object.isValid() || !m_offloadRaw.isOpen() ||
+        info.size() != m_indexedSize || info.lastModified() != m_indexedTime) {
+        return false;
+    }
+
+    const QByteArray document = fragmentDocument(m_offloadRaw, m_offloadRaw.bytes(object), QByteArray());
+    QXmlStreamReader xml(document);
+    xml.setNamespaceProcessing(true);
+    QString defRef;
+    QString value;
+    QString description;
+    int ordinal = 0;
+    while (!xml.atEnd() && !xml.hasError()) {
+        if (xml.readNext() != QXmlStreamReader::StartElement) continue;
+        if (isReqifElement(xml, "ATTRIBUTE-VALUE-XHTML")) {
+            defRef.clear();
+        } else if (isReqifElement(xml, "ATTRIBUTE-DEFINITION-XHTML-REF")) {
+            defRef = xml.readElementText();
+        } else if (isReqifElement(xml, "THE-VALUE") && !defRef.isEmpty()) {
+            value.clear();
+            readXhtmlContent(xml, req.id, value, ordinal, nullptr);
+            if (defRef.contains(QLatin1String("_valm_Description"), Qt::CaseInsensitive)) {
+                description = value;
+            }
+        }
+    }
+    if (xml.hasError()) return false;
+
+    QString scratch;
+    req.description = cleanHtml(description, scratch);
+    req.richDescription = m_keepRichText ? sanitizeXhtml(description) : QString();
+    m_lastOffloaded = req;
+    return true;
+}
+
+qint64 ReqMemoryUsage::total() const {
+    return records + ids + names + descriptions + hierarchy + textIndex + treeItems;
+}
+
+void ReqMemoryUsage::add(const ReqMemoryUsage &other) {
+    records += other.records;
+    ids += other.ids;
+    names += other.names;
+    descriptions += other.descriptions;
+    hierarchy += other.hierarchy;
+    textIndex += other.textIndex;
+    treeItems += other.treeItems;
+}
+
+// 需求树节点估算：QTreeWidgetItem本身与两列数据（文本与需求存储共享）
+qint64 ReqMemoryUsage::treeItemBytes(int itemCount) {
+    return qint64(itemCount) * 256;
 }
 
 // 判断是否为ReqIF命名空间元素
-bool ReqifParser::isReqifElement(const QXmlStreamReader &xml, const QString &localName) {
+bool ReqifParser::isReqifElement(const QXmlStreamReader &xml, const char *localName) const {
     return xml.namespaceUri() == m_reqifNamespace &&
-           xml.name().toString().compare(localName, Qt::CaseInsensitive) == 0;
+           xml.name().compare(QLatin1String(localName), Qt::CaseInsensitive) == 0;
 }
 
 void ReqifParser::fillTreeWithFilter(QTreeWidget *treeWidget, const QString &filterText) {
@@ -451,29 +2427,56 @@ void ReqifParser::fillTreeWithFilter(QTreeWidget *treeWidget, const QString &fil
     treeWidget->setSortingEnabled(false);
     treeWidget->setIndentation(20);
 
+    const int totalCount = fillTreeItemsWithFilter(treeWidget->invisibleRootItem(), filterText);
+
+    // 优化显示
+    if (!m_diskIndex) treeWidget->expandAll();
+    treeWidget->resizeColumnToContents(0);
+    treeWidget->resizeColumnToContents(1);
+
+    // 显示过滤结果统计
+    if (totalCount == 0) {
+        QTreeWidgetItem *noResultItem = new QTreeWidgetItem(treeWidget);
+        noResultItem->setText(1, QString(u8"未找到包含\"%1\"的需求").arg(filterText));
+        noResultItem->setFlags(noResultItem->flags() & ~Qt::ItemIsSelectable);
+    }
+}
+
+// 在指定节点下按关键词过滤填充，返回匹配（含关联父子）的需求数
+int ReqifParser::fillTreeItemsWithFilter(QTreeWidgetItem *rootItem, const QString &filterText) {
+    if (!rootItem) return 0;
+
+    // 超大文件模式：匹配项平铺显示（可展开查看子需求），数量过多时只列出前一部分
+    if (m_diskIndex) {
+        const int maxItems = 1000;
+        int matched = 0;
+        foreach (int index, m_diskIndex->search(filterText, ReqTextSearch::NameField)) {
+            if (!m_diskIndex->isValid(index)) continue;
+            if (++matched <= maxItems) rootItem->addChild(createIndexItem(index));
+        }
+        if (matched > maxItems) {
+            QTreeWidgetItem *moreItem = new QTreeWidgetItem(rootItem);
+            moreItem->setText(1, QString(u8"……另有 %1 条匹配，请细化关键词").arg(matched - maxItems));
+            moreItem->setFlags(moreItem->flags() & ~Qt::ItemIsSelectable);
+        }
+        return matched;
+    }
+
     QMap<QString, QTreeWidgetItem*> itemMap;
     QSet<QString> matchedIds; // 存储匹配的需求ID
 
-    // 1. 查找所有匹配过滤条件的需求
-    for (const auto &req : m_reqMap) {
-        if (!isValidReq(req)) continue;
+    // 1. 查找所有匹配过滤条件的需求（名称已在加载时折叠大小写）
+    foreach (const QString &reqId, findReqs(filterText)) {
+        if (!isValidReq(m_reqMap.value(reqId))) continue;
 
-        // 检查需求名称是否包含过滤文本
-        if (req.name.contains(filterText, Qt::CaseInsensitive)) {
-            // 递归添加所有相关节点：父级、自身、所有子级
-            addRelatedNodes(req.id, matchedIds);
-        }
+        // 递归添加所有相关节点：父级、自身、所有子级
+        addRelatedNodes(reqId, matchedIds);
     }
 
     // 2. 创建匹配需求的节点
     for (const auto &req : m_reqMap) {
         if (!matchedIds.contains(req.id)) continue;
-
-        QTreeWidgetItem *item = new QTreeWidgetItem();
-        item->setText(0, req.sortNum > 0 ? QString::number(req.sortNum) : "");
-        item->setText(1, req.name);
-        item->setData(0, Qt::UserRole, req.id);
-        itemMap[req.id] = item;
+        itemMap[req.id] = createTreeItem(req);
     }
 
     // 3. 构建层次结构（只包含匹配的需求）
@@ -482,24 +2485,12 @@ void ReqifParser::fillTreeWithFilter(QTreeWidget *treeWidget, const QString &fil
 
         QTreeWidgetItem *item = itemMap[req.id];
         if (req.parentId.isEmpty() || !itemMap.contains(req.parentId)) {
-            treeWidget->addTopLevelItem(item);
+            rootItem->addChild(item);
         } else {
             itemMap[req.parentId]->addChild(item);
         }
     }
-
-    // 4. 优化显示
-    treeWidget->expandAll();
-    treeWidget->resizeColumnToContents(0);
-    treeWidget->resizeColumnToContents(1);
-
-    // 显示过滤结果统计
-    int totalCount = matchedIds.size();
-    if (totalCount == 0) {
-        QTreeWidgetItem *noResultItem = new QTreeWidgetItem(treeWidget);
-        noResultItem->setText(1, QString(u8"未找到包含\"%1\"的需求").arg(filterText));
-        noResultItem->setFlags(noResultItem->flags() & ~Qt::ItemIsSelectable);
-    }
+    return matchedIds.size();
 }
 
 // 递归添加相关节点（父级、自身、所有子级）
@@ -530,11 +2521,8 @@ void ReqifParser::addRelatedNodes(const QString &reqId, QSet<QString> &matchedId
 // 递归添加所有子节点
 void ReqifParser::addAllChildren(const QString &parentId, QSet<QString> &matchedIds) {
     // 查找所有直接子节点
-    for (auto it = m_reqMap.constBegin(); it != m_reqMap.constEnd(); ++it) {
-        const QString &id = it.key();
-        const ReqData &req = it.value();
-
-        if (req.parentId == parentId && isValidReq(req)) {
+    foreach (const QString &id, m_childMap.value(parentId)) {
+        if (isValidReq(m_reqMap.value(id))) {
             if (!matchedIds.contains(id)) {
                 matchedIds.insert(id);
                 addAllChildren(id, matchedIds); // 递归添加子节点的子节点
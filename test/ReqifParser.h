@@ -3,54 +3,260 @@
 
 #include <QObject>
 #include <QMap>
+#include <QHash>
 #include <QList>
+#include <QVector>
 #include <QTreeWidget>
 #include <QXmlStreamReader>
 #include <QString>
 #include <QSet>
 #include <QMessageBox>
+#include "ReqTextSearch.h"
+#include "ReqObjectStore.h"
+#include "ReqifRawFile.h"
+#include <QDateTime>
+
+class QFileSystemWatcher;
+class QTimer;
+class ReqRecordWriter;
+class ReqStringPool;
+class ReqDiskIndex;
+class ReqDiskIndexBuilder;
 
 // 需求数据结构（仅保留核心字段）
 struct ReqData {
     QString id;                  // 需求唯一ID
     QString name;                // 需求名称
     QString description;         // 需求描述
+    QString richDescription;     // 净化后的XHTML描述（启用富文本时保留）
     int sortNum = 0;             // 排序号
+    QString outlineNum;          // 章节号（如"3.2.1.4"，用于推断层次）
     int level = 1;               // 需求层级（1为顶层）
     QString parentId;            // 父需求ID（空表示顶层）
+    bool valid = false;          // 是否有效需求（解析后处理时分类）
+};
+
+// 需求统计（解析后处理时汇总并缓存，重新加载前不变）
+struct ReqStatistics {
+    int valid = 0;               // 有效需求数
+    int described = 0;           // 有描述的需求数
+    qint64 idChars = 0;          // ID总字符数
+    qint64 nameChars = 0;        // 名称与章节号总字符数
+    qint64 descriptionChars = 0; // 描述总字符数（描述卸载后为0）
+    qint64 richTextChars = 0;    // 富文本描述总字符数（描述卸载后为0）
+    void add(const ReqData &req);               // 计入一条需求
+    void remove(const ReqData &req);            // 撤销一条已计入的需求（重复ID覆盖时）
+    void add(const ReqStatistics &other);       // 合并
+};
+
+// 内存占用估算（字节）：按字符数和容器节点数计算，共享的字符串按引用分别计入，为上限估计
+struct ReqMemoryUsage {
+    qint64 records = 0;          // 需求存储节点与定长字段
+    qint64 ids = 0;              // 需求ID
+    qint64 names = 0;            // 名称与章节号
+    qint64 descriptions = 0;     // 描述与富文本（卸载后为按需读取用的字节区间索引）
+    qint64 hierarchy = 0;        // 层次索引（子->父、父->子、顶层列表）
+    qint64 textIndex = 0;        // 文本检索索引
+    qint64 treeItems = 0;        // 需求树节点（解析器不持有，由界面按节点数计入）
+    qint64 total() const;
+    void add(const ReqMemoryUsage &other);
+    static qint64 treeItemBytes(int itemCount);  // 需求树节点估算
+};
+
+// 规格（SPECIFICATION）：文档中的一棵需求层次（系统/软件/测试等）
+struct ReqSpecification {
+    QString id;                  // 规格ID（IDENTIFIER）
+    QString name;                // 规格名称（LONG-NAME）
+    QStringList rootIds;         // 第一级需求ID（按层次顺序）
+    bool loaded = false;         // 层次结构与需求对象是否已加载
+};
+
+// 重新加载前后的需求差异
+struct ReqChangeSet {
+    QStringList added;           // 新增需求ID
+    QStringList removed;         // 删除需求ID
+    QStringList changed;         // 内容变化（名称/描述/排序号）的需求ID
+    QStringList moved;           // 父需求变化的需求ID
+    bool isEmpty() const { return added.isEmpty() && removed.isEmpty() && changed.isEmpty() && moved.isEmpty(); }
+};
+
+// 完整性诊断：解析时随流式扫描收集，每个元素只做O(1)检查
+struct ReqDiagnostic {
+    enum Kind {
+        EmptyIdentifier,         // SPEC-OBJECT缺少IDENTIFIER（对象被丢弃）
+        DuplicateId,             // 重复的需求ID（后出现的覆盖先出现的）
+        DanglingReference,       // SPEC-OBJECT-REF引用的需求对象不存在
+        HierarchyCycle,          // 层次结构成环（成环的引用被忽略）
+        UnknownAttribute         // 属性值引用了未定义的属性定义
+    };
+    Kind kind = EmptyIdentifier;
+    QString reqId;               // 相关需求ID（悬空引用时为引用目标）
+    QString detail;              // 补充信息（属性定义引用、父需求等）
+    qint64 line = 0;             // 源文件行号（0为解析结束后判定）
+    QString kindName() const;    // 类别标识（报告用，如"dangling-reference"）
+    QString toString() const;    // 单行描述
 };
 
 class ReqifParser : public QObject
 {
     Q_OBJECT
 public:
+    enum {
+        SpecificationRole = Qt::UserRole + 2,            // 规格节点上保存规格ID的数据角色
+        IndexRecordRole = Qt::UserRole + 3,              // 超大文件模式：需求节点上保存索引记录序号
+        IndexContinueRole = Qt::UserRole + 4             // 超大文件模式："加载更多"节点上保存下一条记录序号
+    };
+    enum { MaxDiagnostics = 10000 };                      // 保留的诊断条数上限（损坏严重的文件只计数）
+
+    // 无显式层次结构（SPEC-HIERARCHY）时的层次推断规则
+    enum HierarchyRule {
+        InferAuto,               // 有章节号时按章节号，否则按排序号
+        InferFromOutline,        // 按章节号（"3.2.1.4"的父需求为"3.2.1"）
+        InferFromSortNumber,     // 按排序号位数（1位为第1级，2位为第2级……）
+        InferNone                // 不推断，全部为顶层
+    };
+
     explicit ReqifParser(QObject *parent = nullptr);
+    ~ReqifParser();
     bool load(const QString &filePath);                  // 加载并解析ReqIF文件
+    bool reload();                                       // 增量重新加载当前文件（仅应用差异）
+    void setAutoReload(bool enabled);                    // 文件变化时自动增量重新加载
+    bool streamTo(const QString &filePath, ReqRecordWriter &writer); // 边解析边导出，不保留需求数据
+    bool writeRecords(ReqRecordWriter &writer) const;    // 导出已加载的全部需求
+    QString getReqPath(const QString &reqId) const;      // 需求路径（根到自身的ID，以'/'分隔）
+    QList<ReqEmbeddedObject> getReqObjects(const QString &reqId) const; // 需求描述中的嵌入对象
+    QString extractObject(const ReqEmbeddedObject &object); // 按需提取嵌入对象到缓存目录，返回文件路径
+    ReqObjectStore &objectStore();                       // 嵌入对象存储（缓存目录等设置）
     void fillTree(QTreeWidget *treeWidget);              // 填充需求树到UI
     void fillTreeWithFilter(QTreeWidget *treeWidget, const QString &filterText); // 按关键词过滤填充
+    void updateTree(QTreeWidget *treeWidget, const ReqChangeSet &changes); // 按差异局部更新需求树
+    void fillTreeItems(QTreeWidgetItem *rootItem);       // 在指定节点下填充需求（多文档时每个文档一个根节点）
+    int fillTreeItemsWithFilter(QTreeWidgetItem *rootItem, const QString &filterText); // 按关键词过滤填充，返回匹配数
+    void updateTreeItems(QTreeWidgetItem *rootItem, const ReqChangeSet &changes); // 按差异局部更新指定节点下的需求
     QString getReqDescription(const QString &reqId);     // 根据ID获取需求描述
+    QString getReqRichDescription(const QString &reqId) const; // 根据ID获取富文本描述（未启用时为空）
+    void setKeepRichText(bool keep);                     // 解析时是否保留富文本描述（下次加载生效）
+    bool keepRichText() const;
+    void setLazyLoading(bool lazy);                      // 加载时只索引规格，打开规格时才解析其层次与需求（下次加载生效）
+    bool lazyLoading() const;
+    void setHierarchyRule(HierarchyRule rule);           // 层次推断规则（下次加载生效）
+    HierarchyRule hierarchyRule() const;
+    void setOutlineAttribute(const QString &defRefKey);  // 章节号属性（属性定义引用包含该关键字，默认ChapterNumber）
+    QList<ReqSpecification> specifications() const;      // 文档中的规格（按文档顺序）
+    bool loadSpecification(const QString &specId);       // 加载规格的层次结构及其引用的需求对象
+    bool fillSpecificationItem(QTreeWidgetItem *specItem); // 加载并填充规格节点（已有子节点时不重复填充）
+    bool fillIndexItem(QTreeWidgetItem *item);           // 超大文件模式：展开节点或点击"加载更多"时按批填充
     int getAllReqCount() const;                          // 获取总需求数
-    int getValidReqCount() const;                        // 获取有效需求数（非空名称）
+    int getValidReqCount() const;                        // 获取有效需求数（非空名称，缓存值）
+    ReqStatistics statistics() const;                    // 需求统计（缓存值）
+    ReqMemoryUsage memoryUsage() const;                  // 内存占用估算（按分类，不遍历需求）
+    void setMemoryBudget(qint64 bytes);                  // 内存预算（字节，0为不限，下次加载生效）
+    qint64 memoryBudget() const;
+    bool descriptionsOffloaded() const;                  // 超出预算后描述是否已改为按需从源文件读取
+    void setOutOfCore(bool enabled);                     // 超大文件模式：需求写入磁盘索引，按需读取（下次加载生效）
+    bool outOfCore() const;
+    void setStrict(bool strict);                         // 严格模式：发现第一个完整性问题即中止并判定加载失败
+    bool strict() const;
+    // 最近一次加载的完整性诊断（按发现顺序，最多保留MaxDiagnostics条）
+    // 延迟加载时空ID与重复ID在规格索引时检查，层次问题随规格加载补充；片段不含SPEC-TYPES，不检查属性定义引用
+    QVector<ReqDiagnostic> diagnostics() const;
+    int diagnosticCount() const;                         // 诊断总数（含未保留的）
+    bool getReq(const QString &reqId, ReqData &req) const; // 根据ID获取需求（不存在返回false）
+    QStringList getTopReqIds() const;                    // 获取顶层需求ID列表
+    QStringList getChildIds(const QString &parentId) const; // 获取直接子需求ID列表
+    QString filePath() const;                            // 当前加载的文件路径
+    QString reqifNamespace() const;                      // ReqIF命名空间
+    QXmlStreamNamespaceDeclarations namespaceDeclarations() const; // 根元素上的命名空间声明
+    QString errorString() const;                         // 最近一次加载失败的原因
+    void setInteractive(bool interactive);               // 是否弹窗提示错误（守护进程等无界面场景关闭）
+    void setStringPool(ReqStringPool *pool);             // 共享字符串驻留池（多文档去重，下次加载生效）
+    QStringList findReqs(const QString &text, bool includeDescription = false) const; // 不区分大小写检索需求ID
+    const ReqTextSearch &textIndex() const;              // 文本检索索引（句柄级访问）
+
+signals:
+    void reqsChanged(const ReqChangeSet &changes);       // 增量重新加载后的需求差异
+    void reloadFailed(const QString &error);             // 自动重新加载失败（保留旧数据）
+
+private slots:
+    void onFileChanged(const QString &filePath);         // 监视的文件发生变化
+    void onReloadTimeout();                              // 合并短时间内的多次变化后重新加载
 
 private:
+    // 待后处理的需求原始文本：解析时只收集XHTML，清理与分类在解析结束后并行执行
+    struct RawReqText {
+        ReqData *req = nullptr;  // 需求存储中的记录（或流式导出时的当前需求）
+        QString name;            // 名称XHTML
+        QString description;     // 描述XHTML
+        bool hasName = false;
+        bool hasDescription = false;
+    };
+
+    // 解析期完整性检查状态（每个文档或片段重置）
+    struct IntegrityState {
+        QSet<QString> attributeDefs;       // 已出现的属性定义IDENTIFIER
+        bool typesSeen = false;            // 出现过SPEC-TYPES（片段文档没有，不检查属性定义）
+        bool typesClosed = false;          // SPEC-TYPES已结束：之后的未知定义可立即判定
+        bool objectsClosed = false;        // SPEC-OBJECTS已结束：之后的悬空引用可立即判定
+        QVector<ReqDiagnostic> pending;    // 出现时尚不能判定的引用，文档结束时复核
+    };
+
     // 核心解析方法
     bool parseXml(const QString &xmlPath);               // 解析XML文件
-    void parseHierarchy(QXmlStreamReader &xml, const QString &parentId); // 递归解析层次结构
+    bool parseDocument(QIODevice *device);               // 解析XML内容（文件或按规格拼接的片段）
+    bool readRootElement(const QString &xmlPath);        // 只读取根元素的命名空间与声明
+    bool indexSpecifications(const QString &xmlPath);    // 延迟加载：只索引规格与SPEC-OBJECT字节区间
+    bool loadOutOfCore(const QString &filePath);         // 超大文件模式：打开有效的磁盘索引，否则流式解析重建
+    void parseHierarchy(QXmlStreamReader &xml, const QString &parentId, QSet<QString> &ancestors); // 递归解析层次结构（ancestors为当前嵌套路径，防环）
 
     // 属性解析方法
     void parseIntegerAttribute(QXmlStreamReader &xml, ReqData &currentReq); // 解析排序号
-    void parseXhtmlAttribute(QXmlStreamReader &xml, ReqData &currentReq);  // 解析名称/描述
+    void parseStringAttribute(QXmlStreamReader &xml, ReqData &currentReq);  // 解析章节号
+    void parseXhtmlAttribute(QXmlStreamReader &xml, ReqData &currentReq, RawReqText &raw); // 解析名称/描述（原始XHTML）
 
     // 层次结构辅助处理
-    void inferHierarchyFromSortNumbers();                // 从排序号推断层次
+    void inferHierarchy();                               // 按推断规则从章节号/排序号推断层次
     void updateTopLevelReqs();                           // 更新顶层需求列表
-    int calculateLevel(const QString &reqId);            // 计算需求层级（防循环）
+    int calculateLevel(const QString &reqId) const;      // 计算需求层级（父链深度）
+    QHash<QString, QString> breakHierarchyCycles(const QStringList &reqIds); // 断开父链上的环，返回断开的需求 -> 原父需求
+    void buildChildMap();                                // 构建父->子索引
+    void buildTextIndex();                               // 构建文本检索索引（一次性折叠大小写）
+    void finishHierarchy();                              // 解析后处理：推断层次、层级、顶层列表、索引
+    void finishHierarchyIncremental();                   // 延迟加载规格后只更新本次新增或重新挂载的需求
+    void addSubtreeItems(QTreeWidgetItem *parentItem, const QString &reqId, QSet<QString> &visited) const; // 按父->子索引添加子树
 
     // 工具方法
-    bool isValidReq(const ReqData &req) const;           // 判断需求是否有效
-    QString cleanHtml(const QString &htmlText);          // 清理HTML标签
-    QString readXhtmlContent(QXmlStreamReader &xml);     // 读取嵌套XHTML内容
-    bool isReqifElement(const QXmlStreamReader &xml, const QString &localName); // 判断ReqIF元素
+    void reportError(const QString &title, const QString &message); // 记录并（可选）弹窗提示错误
+    void addDiagnostic(const ReqDiagnostic &diagnostic, QXmlStreamReader *xml = nullptr); // 记录诊断（严格模式下经xml中止解析）
+    void checkAttributeDefinition(QXmlStreamReader &xml, const QString &defRef, const QString &reqId); // 检查属性定义引用
+    bool failOnDiagnostics();                            // 严格模式下有诊断时报告失败
+    bool isKnownReq(const QString &reqId) const;         // 需求对象是否已解析（含构建中的磁盘索引）
+    bool isValidReq(const ReqData &req) const;           // 判断需求是否有效（后处理时已分类）
+    static bool classifyReq(const ReqData &req);         // 有效性分类规则
+    void postProcess(QVector<RawReqText> &pending);      // 并行后处理：清理HTML、分类有效性、汇总统计
+    void flushPending(QVector<RawReqText> &pending, bool duplicates); // 后处理一批并清空（重复ID只保留最后一次）
+    static void processReq(RawReqText &raw, bool keepRichText, ReqStringPool *pool,
+                           QString &scratch, ReqStatistics &stats); // 后处理单条需求（可在工作线程执行）
+    QString intern(const QString &text) const;           // 经驻留池去重（未设置时原样返回）
+    static QByteArray reqFingerprint(const ReqData &req); // 需求内容指纹（名称/描述/富文本/排序号）
+    QTreeWidgetItem *createTreeItem(const ReqData &req) const; // 创建需求树节点
+    QTreeWidgetItem *createSpecificationItem(const ReqSpecification &spec) const; // 创建规格节点
+    QTreeWidgetItem *createIndexItem(int index) const;   // 超大文件模式：由索引记录创建需求树节点
+    void addIndexItems(QTreeWidgetItem *parentItem, int first) const; // 超大文件模式：从first起按批添加兄弟节点
+    static QString cleanHtml(const QString &htmlText, QString &scratch); // 清理HTML标签（单次扫描，中间结果写入scratch）
+    static QString sanitizeXhtml(const QString &xhtml);  // 净化XHTML（仅保留排版标签，嵌入图片改为占位）
+    static void readXhtmlContent(QXmlStreamReader &xml, const QString &reqId, QString &content,
+                                 int &ordinal, ReqObjectStore *store); // 读取嵌套XHTML内容到content（store非空时记录嵌入对象）
+    bool isReqifElement(const QXmlStreamReader &xml, const char *localName) const; // 判断ReqIF元素（不分配临时字符串）
+    void releaseDataAsync();                             // 需求存储移交后台线程释放
+    void enforceMemoryBudget();                          // 超出预算（或已卸载）时卸载描述
+    bool offloadDescriptions();                          // 卸载描述：保留指纹与SPEC-OBJECT字节区间，释放文本
+    void dropDescription(ReqData &req);                  // 记录指纹后释放单条需求的描述与富文本
+    bool readOffloadedText(ReqData &req) const;          // 从源文件读回单条需求的描述与富文本（只解析该SPEC-OBJECT）
+    QByteArray fragmentDocument(const ReqifRawFile &raw, const QByteArray &objects,
+                                const QByteArray &specification) const; // 由原始字节拼接可解析的最小文档
+    void captureScopeDeclarations(const ReqifRawFile &raw); // 记录片段所在层级上的命名空间声明
+    int sourceLine(qint64 line) const;                   // 片段文档行号换算为源文件行号（无法对应时返回0）
+    int sourceColumn(qint64 line, qint64 column) const;  // 片段文档列号换算为源文件列号
     // 添加这两个私有方法
      void addRelatedNodes(const QString &reqId, QSet<QString> &matchedIds);
      void addAllChildren(const QString &parentId, QSet<QString> &matchedIds);
@@ -59,7 +265,57 @@ private:
     QMap<QString, ReqData> m_reqMap;       // 需求存储（ID -> 需求数据）
     QMap<QString, QString> m_parentMap;    // 父子关系（子ID -> 父ID）
     QList<QString> m_topReqIds;            // 顶层需求ID列表
+    QMap<QString, QStringList> m_childMap; // 父子关系（父ID -> 子ID列表）
     QString m_reqifNamespace;              // ReqIF标准命名空间
+    QList<ReqSpecification> m_specs;       // 规格列表（按文档顺序）
+    int m_currentSpec = -1;                // 解析中的规格（m_specs下标）
+    bool m_lazyLoading = false;            // 是否按规格延迟加载
+    HierarchyRule m_hierarchyRule = InferAuto; // 层次推断规则
+    QString m_outlineAttribute = "ChapterNumber"; // 章节号属性定义引用关键字
+    QHash<QString, ReqifByteRange> m_specRanges;       // 规格ID -> SPECIFICATION字节区间（延迟加载时）
+    QHash<QString, ReqifByteRange> m_specObjectRanges; // 需求ID -> SPEC-OBJECT字节区间（延迟加载时）
+    QHash<QString, int> m_specLines;                   // 规格ID -> SPECIFICATION起始行（延迟加载时）
+    QHash<QString, int> m_specObjectLines;             // 需求ID -> SPEC-OBJECT起始行（延迟加载时，诊断行号换算）
+    struct FragmentLine {
+        int docLine;                                   // 片段在拼接文档中的起始行
+        int line;                                      // 片段在源文件中的起始行
+        int column;                                    // 片段起点在源文件该行中的列偏移
+    };
+    QVector<FragmentLine> m_fragmentLines;             // 解析拼接文档期间的行号对照（为空时行号即源文件行号）
+    qint64 m_indexedSize = 0;              // 建立索引时的文件大小与修改时间（区间仅对该版本有效）
+    QDateTime m_indexedTime;
+    ReqTextSearch m_textIndex;             // 名称/描述检索索引
+    QString m_filePath;                    // 当前文件路径
+    QXmlStreamNamespaceDeclarations m_namespaceDecls; // 根元素命名空间声明（导出时沿用）
+    QByteArray m_objectScopeDecls;         // SPEC-OBJECTS及其祖先（根元素除外）上的命名空间声明（原始属性文本）
+    QByteArray m_specScopeDecls;           // SPECIFICATIONS及其祖先（根元素除外）上的命名空间声明
+    QString m_errorString;                 // 最近一次错误信息
+    bool m_interactive = true;             // 是否弹窗提示错误
+    bool m_keepRichText = false;           // 是否保留富文本描述
+    ReqObjectStore m_objectStore;          // 嵌入对象索引（按需提取）
+    int m_objectOrdinal = 0;               // 当前SPEC-OBJECT内的嵌入对象序号
+    ReqRecordWriter *m_sink = nullptr;     // 流式导出目标（非空时不保留需求数据）
+    ReqStringPool *m_stringPool = nullptr; // 共享字符串驻留池（不持有）
+    QString m_xhtmlScratch;                // 解析期复用缓冲：XHTML内容（只增不减，逐个属性重置）
+    QString m_textScratch;                 // 流式导出时清理文本的复用缓冲
+    ReqStatistics m_stats;                 // 需求统计缓存（加载时汇总，重新加载时替换）
+    qint64 m_memoryBudget = 0;             // 内存预算（字节，0为不限）
+    bool m_descriptionsOffloaded = false;  // 描述已卸载，按需从源文件读取
+    mutable ReqData m_lastOffloaded;       // 最近一次读回的需求（显示时描述与富文本连续读取）
+    ReqifRawFile m_offloadRaw;             // 描述卸载期间保持映射的源文件（按需读回时不再逐次打开）
+    QHash<QString, QByteArray> m_fingerprints; // 上次加载的需求指纹（ID -> 指纹）
+    QFileSystemWatcher *m_watcher = nullptr;   // 文件监视（启用自动重新加载时创建）
+    QTimer *m_reloadTimer = nullptr;           // 重新加载防抖定时器
+    bool m_outOfCore = false;                  // 超大文件模式（磁盘索引）
+    ReqDiskIndex *m_diskIndex = nullptr;       // 磁盘索引（超大文件模式加载成功后非空）
+    ReqDiskIndexBuilder *m_indexBuilder = nullptr; // 构建中的磁盘索引（非空时解析结果写入索引）
+    bool m_strict = false;                     // 严格模式（发现完整性问题即失败）
+    QVector<ReqDiagnostic> m_diagnostics;      // 完整性诊断（最多MaxDiagnostics条）
+    int m_diagnosticTotal = 0;                 // 诊断总数
+    IntegrityState m_integrity;                // 当前文档的完整性检查状态
+    QStringList m_parsedIds;                   // 本次解析新加入需求存储的需求
+    QStringList m_linkedIds;                   // 本次解析中建立父子关系或作为规格根的需求
+    QHash<QString, QString> m_previousParents; // 本次解析中被重新挂载的已有需求 -> 解析前的父需求
 };
 
 #endif // REQIFPARSER_H
@@ -0,0 +1,465 @@
+﻿#include "ReqifRawFile.h"
+#include <QTextCodec>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+const qint64 TranscodeChunkSize = 1024 * 1024;           // 转码块大小
+
+inline bool isNameEnd(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '>' || c == '/';
+}
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// 在[from, end)内查找字节序列，返回起始位置（未找到返回-1）
+qint64 findSeq(const char *data, qint64 from, qint64 end, const char *seq) {
+    const size_t len = strlen(seq);
+    const char *hit = std::search(data + from, data + end, seq, seq + len);
+    return hit == data + end ? -1 : qint64(hit - data);
+}
+
+// 宽字符编码（UTF-16/UTF-32）：按BOM或XML声明开头"<?"的字节模式识别，其余编码与ASCII兼容
+QTextCodec *detectWideCodec(const char *data, qint64 size) {
+    const QByteArray head = QByteArray::fromRawData(data, int(qMin<qint64>(size, 4)));
+    QTextCodec *codec = QTextCodec::codecForUtfText(head, nullptr);
+    if (codec) return codec->mibEnum() == 106 ? nullptr : codec; // UTF-8 BOM
+    if (head.size() < 4) return nullptr;
+    if (memcmp(data, "<\0?\0", 4) == 0) return QTextCodec::codecForName("UTF-16LE");
+    if (memcmp(data, "\0<\0?", 4) == 0) return QTextCodec::codecForName("UTF-16BE");
+    if (memcmp(data, "<\0\0\0", 4) == 0) return QTextCodec::codecForName("UTF-32LE");
+    if (memcmp(data, "\0\0\0<", 4) == 0) return QTextCodec::codecForName("UTF-32BE");
+    return nullptr;
+}
+
+} // namespace
+
+ReqifRawFile::ReqifRawFile()
+{
+}
+
+ReqifRawFile::~ReqifRawFile() {
+    close();
+}
+
+// 映射文件
+bool ReqifRawFile::open(const QString &filePath) {
+    close();
+    m_file.setFileName(filePath);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+    m_size = m_file.size();
+    if (m_size == 0) {
+        m_errorString = u8"文件为空";
+        m_file.close();
+        return false;
+    }
+    m_data = reinterpret_cast<const char *>(m_file.map(0, m_size));
+    if (!m_data) {
+        m_errorString = m_file.errorString();
+        m_file.close();
+        m_size = 0;
+        return false;
+    }
+    m_wideCodec = detectWideCodec(m_data, m_size);
+    return true;
+}
+
+// 映射为UTF-8内容：宽字符编码文件分块转码到临时副本后映射副本，ASCII兼容编码与open()相同
+bool ReqifRawFile::openUtf8(const QString &filePath) {
+    if (!open(filePath)) return false;
+    QTextCodec *codec = m_wideCodec;
+    if (!codec) return true;
+
+    QScopedPointer<QTemporaryFile> copy(new QTemporaryFile);
+    if (!copy->open()) {
+        m_errorString = copy->errorString();
+        close();
+        return false;
+    }
+    QScopedPointer<QTextDecoder> decoder(codec->makeDecoder());
+    for (qint64 offset = 0; offset < m_size; offset += TranscodeChunkSize) {
+        const int length = int(qMin(TranscodeChunkSize, m_size - offset));
+        const QByteArray utf8 = decoder->toUnicode(m_data + offset, length).toUtf8();
+        if (copy->write(utf8) != utf8.size()) {
+            m_errorString = copy->errorString();
+            close();
+            return false;
+        }
+    }
+    close();
+    if (!copy->flush() || copy->size() == 0) {
+        m_errorString = copy->errorString();
+        return false;
+    }
+    m_size = copy->size();
+    m_data = reinterpret_cast<const char *>(copy->map(0, m_size));
+    if (!m_data) {
+        m_errorString = copy->errorString();
+        m_size = 0;
+        return false;
+    }
+    m_transcoded.swap(copy);
+    m_wideCodec = codec;
+    return true;
+}
+
+QTextCodec *ReqifRawFile::wideCodec() const {
+    return m_wideCodec;
+}
+
+// 解除映射（转码副本随之删除）
+void ReqifRawFile::close() {
+    if (m_data) {
+        QFile &file = m_transcoded ? static_cast<QFile &>(*m_transcoded) : m_file;
+        file.unmap(reinterpret_cast<uchar *>(const_cast<char *>(m_data)));
+        m_data = nullptr;
+    }
+    m_size = 0;
+    m_transcoded.reset();
+    m_wideCodec = nullptr;
+    if (m_file.isOpen()) m_file.close();
+}
+
+bool ReqifRawFile::isOpen() const {
+    return m_data != nullptr;
+}
+
+QString ReqifRawFile::errorString() const {
+    return m_errorString;
+}
+
+const char *ReqifRawFile::data() const {
+    return m_data;
+}
+
+qint64 ReqifRawFile::size() const {
+    return m_size;
+}
+
+ReqifByteRange ReqifRawFile::whole() const {
+    ReqifByteRange range;
+    range.begin = 0;
+    range.end = m_size;
+    return range;
+}
+
+// 拷贝区间内容
+QByteArray ReqifRawFile::bytes(const ReqifByteRange &range) const {
+    if (!m_data || !range.isValid() || range.end > m_size) return QByteArray();
+    return QByteArray(m_data + range.begin, int(range.size()));
+}
+
+// 查找下一个本地名为localName的元素
+ReqifByteRange ReqifRawFile::findElement(const QByteArray &localName, const ReqifByteRange &scope) const {
+    ReqifByteRange result;
+    if (!m_data || !scope.isValid()) return result;
+
+    const qint64 end = qMin(scope.end, m_size);
+    qint64 pos = scope.begin;
+    while (pos < end) {
+        const char *lt = static_cast<const char *>(memchr(m_data + pos, '<', size_t(end - pos)));
+        if (!lt) break;
+        const qint64 p = lt - m_data;
+        if (p + 1 >= end) break;
+
+        const char c = m_data[p + 1];
+        if (c == '!' || c == '?') {
+            pos = skipMarkup(p, end);
+            continue;
+        }
+        if (c == '/' || !nameEquals(p + 1, end, localName, true)) {
+            pos = p + 1;
+            continue;
+        }
+
+        // 命中开始标签：自闭合直接返回，否则按同名嵌套深度查找结束标签
+        const qint64 startEnd = tagEnd(p, end);
+        if (startEnd < 0) break;
+        if (m_data[startEnd - 2] == '/') {
+            result.begin = p;
+            result.end = startEnd;
+            return result;
+        }
+
+        int localStart = 0;
+        const QByteArray qualifiedName(m_data + p + 1, nameLength(p + 1, end, &localStart));
+        int depth = 1;
+        qint64 q = startEnd;
+        while (q < end) {
+            lt = static_cast<const char *>(memchr(m_data + q, '<', size_t(end - q)));
+            if (!lt) break;
+            q = lt - m_data;
+            if (q + 1 >= end) break;
+
+            const char next = m_data[q + 1];
+            if (next == '!' || next == '?') {
+                q = skipMarkup(q, end);
+            }
+            else if (next == '/') {
+                const qint64 te = tagEnd(q, end);
+                if (te < 0) break;
+                if (nameEquals(q + 2, end, qualifiedName, false) && --depth == 0) {
+                    result.begin = p;
+                    result.end = te;
+                    return result;
+                }
+                q = te;
+            }
+            else {
+                const qint64 te = tagEnd(q, end);
+                if (te < 0) break;
+                if (m_data[te - 2] != '/' && nameEquals(q + 1, end, qualifiedName, false)) {
+                    ++depth;
+                }
+                q = te;
+            }
+        }
+        break; // 结束标签缺失（文件不完整）
+    }
+    return result;
+}
+
+// 查找开始标签：读取外层元素的属性时不必扫描到其结束标签
+ReqifByteRange ReqifRawFile::findStartTag(const QByteArray &localName, const ReqifByteRange &scope) const {
+    ReqifByteRange result;
+    if (!m_data || !scope.isValid()) return result;
+
+    const qint64 end = qMin(scope.end, m_size);
+    qint64 pos = scope.begin;
+    while (pos < end) {
+        const char *lt = static_cast<const char *>(memchr(m_data + pos, '<', size_t(end - pos)));
+        if (!lt) break;
+        const qint64 p = lt - m_data;
+        if (p + 1 >= end) break;
+
+        const char c = m_data[p + 1];
+        if (c == '!' || c == '?') {
+            pos = skipMarkup(p, end);
+            continue;
+        }
+        if (c == '/' || !nameEquals(p + 1, end, localName, true)) {
+            pos = p + 1;
+            continue;
+        }
+        const qint64 startEnd = tagEnd(p, end);
+        if (startEnd < 0) break;
+        result.begin = p;
+        result.end = startEnd;
+        return result;
+    }
+    return result;
+}
+
+// 在直接子元素中查找：逐个跳过整个子元素，只比较本层的标签名
+ReqifByteRange ReqifRawFile::findChild(const QByteArray &localName, const ReqifByteRange &element) const {
+    ReqifByteRange rest = contentRange(element);
+    while (rest.isValid() && rest.begin < rest.end) {
+        const char *lt = static_cast<const char *>(memchr(m_data + rest.begin, '<', size_t(rest.end - rest.begin)));
+        if (!lt) break;
+        const qint64 p = lt - m_data;
+        if (p + 1 >= rest.end) break;
+
+        const char c = m_data[p + 1];
+        if (c == '!' || c == '?') {
+            rest.begin = skipMarkup(p, rest.end);
+            continue;
+        }
+        if (c == '/') break;
+
+        int localStart = 0;
+        const int length = nameLength(p + 1, rest.end, &localStart);
+        const QByteArray childName(m_data + p + 1 + localStart, length - localStart);
+        ReqifByteRange scope = rest;
+        scope.begin = p;
+        const ReqifByteRange child = findElement(childName, scope);
+        if (!child.isValid()) break;
+        if (childName == localName) return child;
+        rest.begin = child.end;
+    }
+    return ReqifByteRange();
+}
+
+// 元素内容区间
+ReqifByteRange ReqifRawFile::contentRange(const ReqifByteRange &element) const {
+    ReqifByteRange result;
+    if (!m_data || !element.isValid()) return result;
+
+    const qint64 startEnd = tagEnd(element.begin, element.end);
+    if (startEnd < 0) return result;
+    result.begin = startEnd;
+    result.end = startEnd;
+    if (m_data[startEnd - 2] == '/') return result;
+
+    for (qint64 i = element.end - 1; i >= startEnd; --i) {
+        if (m_data[i] == '<') {
+            result.end = i;
+            break;
+        }
+    }
+    return result;
+}
+
+// 开始标签中的属性原始值
+QByteArray ReqifRawFile::attribute(const ReqifByteRange &element, const QByteArray &name) const {
+    return bytes(attributeRange(element, name));
+}
+
+// 开始标签中属性值的字节区间
+ReqifByteRange ReqifRawFile::attributeRange(const ReqifByteRange &element, const QByteArray &name) const {
+    ReqifByteRange result;
+    if (!m_data || !element.isValid()) return result;
+
+    const qint64 end = tagEnd(element.begin, element.end);
+    if (end < 0) return result;
+
+    int localStart = 0;
+    qint64 i = element.begin + 1 + nameLength(element.begin + 1, end, &localStart);
+    while (i < end) {
+        while (i < end && isSpace(m_data[i])) ++i;
+        const qint64 nameBegin = i;
+        while (i < end && m_data[i] != '=' && !isNameEnd(m_data[i])) ++i;
+        const qint64 nameEnd = i;
+        while (i < end && (isSpace(m_data[i]) || m_data[i] == '=')) ++i;
+        if (i >= end || (m_data[i] != '"' && m_data[i] != '\'')) break;
+
+        const char quote = m_data[i];
+        const char *close = static_cast<const char *>(memchr(m_data + i + 1, quote, size_t(end - i - 1)));
+        if (!close) break;
+        const qint64 valueEnd = close - m_data;
+        if (nameEnd - nameBegin == name.size() &&
+            memcmp(m_data + nameBegin, name.constData(), size_t(name.size())) == 0) {
+            result.begin = i + 1;
+            result.end = valueEnd;
+            return result;
+        }
+        i = valueEnd + 1;
+    }
+    return result;
+}
+
+// 开始标签中的命名空间声明
+ReqifAttributeList ReqifRawFile::namespaceDeclarations(const ReqifByteRange &element) const {
+    ReqifAttributeList result;
+    if (!m_data || !element.isValid()) return result;
+
+    const qint64 end = tagEnd(element.begin, element.end);
+    if (end < 0) return result;
+
+    int localStart = 0;
+    qint64 i = element.begin + 1 + nameLength(element.begin + 1, end, &localStart);
+    while (i < end) {
+        while (i < end && isSpace(m_data[i])) ++i;
+        const qint64 nameBegin = i;
+        while (i < end && m_data[i] != '=' && !isNameEnd(m_data[i])) ++i;
+        const QByteArray name(m_data + nameBegin, int(i - nameBegin));
+        while (i < end && (isSpace(m_data[i]) || m_data[i] == '=')) ++i;
+        if (i >= end || (m_data[i] != '"' && m_data[i] != '\'')) break;
+
+        const char quote = m_data[i];
+        const char *close = static_cast<const char *>(memchr(m_data + i + 1, quote, size_t(end - i - 1)));
+        if (!close) break;
+        const qint64 valueEnd = close - m_data;
+        if (name == "xmlns" || name.startsWith("xmlns:")) {
+            result.append(qMakePair(name, QByteArray(m_data + i + 1, int(valueEnd - i - 1))));
+        }
+        i = valueEnd + 1;
+    }
+    return result;
+}
+
+// 索引scope内所有localName元素
+QHash<QString, ReqifByteRange> ReqifRawFile::indexElements(const QByteArray &localName,
+                                                           const ReqifByteRange &scope) const {
+    QHash<QString, ReqifByteRange> index;
+    ReqifByteRange rest = scope;
+    for (;;) {
+        const ReqifByteRange element = findElement(localName, rest);
+        if (!element.isValid()) break;
+        index.insert(QString::fromUtf8(attribute(element, "IDENTIFIER")), element);
+        rest.begin = element.end;
+    }
+    return index;
+}
+
+// XML声明中的编码
+QByteArray ReqifRawFile::encoding() const {
+    if (!m_data) return QByteArray();
+    if (m_transcoded) return "UTF-8";
+    if (m_wideCodec) return m_wideCodec->name();
+
+    qint64 begin = 0;
+    if (m_size >= 3 && memcmp(m_data, "\xEF\xBB\xBF", 3) == 0) begin = 3; // UTF-8 BOM
+    if (m_size - begin < 5 || memcmp(m_data + begin, "<?xml", 5) != 0) return "UTF-8";
+
+    const qint64 declEnd = findSeq(m_data, begin, qMin(m_size, begin + 256), "?>");
+    const qint64 attr = declEnd < 0 ? -1 : findSeq(m_data, begin, declEnd, "encoding");
+    if (attr < 0) return "UTF-8";
+
+    qint64 i = attr + 8;
+    while (i < declEnd && (isSpace(m_data[i]) || m_data[i] == '=')) ++i;
+    if (i >= declEnd) return "UTF-8";
+    const char quote = m_data[i];
+    const qint64 valueBegin = i + 1;
+    qint64 valueEnd = valueBegin;
+    while (valueEnd < declEnd && m_data[valueEnd] != quote) ++valueEnd;
+    return QByteArray(m_data + valueBegin, int(valueEnd - valueBegin));
+}
+
+// 跳过注释/CDATA/处理指令/DOCTYPE
+qint64 ReqifRawFile::skipMarkup(qint64 pos, qint64 end) const {
+    qint64 found = -1;
+    if (pos + 4 <= end && memcmp(m_data + pos, "<!--", 4) == 0) {
+        found = findSeq(m_data, pos + 4, end, "-->");
+        return found < 0 ? end : found + 3;
+    }
+    if (pos + 9 <= end && memcmp(m_data + pos, "<![CDATA[", 9) == 0) {
+        found = findSeq(m_data, pos + 9, end, "]]>");
+        return found < 0 ? end : found + 3;
+    }
+    if (m_data[pos + 1] == '?') {
+        found = findSeq(m_data, pos + 2, end, "?>");
+        return found < 0 ? end : found + 2;
+    }
+    found = tagEnd(pos, end);
+    return found < 0 ? end : found;
+}
+
+// 标签结束符'>'之后的位置
+qint64 ReqifRawFile::tagEnd(qint64 pos, qint64 end) const {
+    for (qint64 i = pos + 1; i < end; ++i) {
+        const char c = m_data[i];
+        if (c == '>') return i + 1;
+        if (c == '"' || c == '\'') {
+            const char *close = static_cast<const char *>(memchr(m_data + i + 1, c, size_t(end - i - 1)));
+            if (!close) return -1;
+            i = close - m_data;
+        }
+    }
+    return -1;
+}
+
+// 标签名长度及本地名起点
+int ReqifRawFile::nameLength(qint64 pos, qint64 end, int *localStart) const {
+    *localStart = 0;
+    qint64 i = pos;
+    while (i < end && !isNameEnd(m_data[i])) {
+        if (m_data[i] == ':') *localStart = int(i - pos + 1);
+        ++i;
+    }
+    return int(i - pos);
+}
+
+// 标签名比较（localOnly时忽略命名空间前缀）
+bool ReqifRawFile::nameEquals(qint64 pos, qint64 end, const QByteArray &name, bool localOnly) const {
+    int localStart = 0;
+    const int length = nameLength(pos, end, &localStart);
+    const int offset = localOnly ? localStart : 0;
+    return length - offset == name.size() &&
+           memcmp(m_data + pos + offset, name.constData(), size_t(name.size())) == 0;
+}
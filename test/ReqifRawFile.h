@@ -0,0 +1,80 @@
+﻿#ifndef REQIFRAWFILE_H
+#define REQIFRAWFILE_H
+
+#include <QFile>
+#include <QScopedPointer>
+#include <QTemporaryFile>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QByteArray>
+#include <QString>
+
+class QTextCodec;
+
+// 文件内字节区间 [begin, end)
+struct ReqifByteRange {
+    qint64 begin = -1;
+    qint64 end = -1;
+    bool isValid() const { return begin >= 0 && end >= begin; }
+    qint64 size() const { return isValid() ? end - begin : 0; }
+};
+
+typedef QList<QPair<QByteArray, QByteArray>> ReqifAttributeList; // 属性名 -> 原始值（保持文档顺序）
+
+// ReqIF原始字节访问：内存映射文件，按元素本地名定位字节区间（不做XML解码）
+// 用于原样拷贝SPEC-OBJECT等片段、按需回读单个元素
+// 字节扫描只对ASCII兼容的编码有效；UTF-16/UTF-32文件用openUtf8()转为UTF-8临时副本后扫描
+class ReqifRawFile
+{
+public:
+    ReqifRawFile();
+    ~ReqifRawFile();
+
+    bool open(const QString &filePath);                 // 映射文件（失败时可通过errorString获取原因）
+    bool openUtf8(const QString &filePath);             // 映射文件，宽字符编码先流式转为UTF-8临时副本（区间为副本中的位置）
+    QTextCodec *wideCodec() const;                      // 源文件为UTF-16/UTF-32时的编码（转码后仍为源编码），否则为空
+    void close();                                       // 解除映射
+    bool isOpen() const;
+    QString errorString() const;
+
+    const char *data() const;                           // 文件内容
+    qint64 size() const;                                // 文件大小
+    ReqifByteRange whole() const;                       // 整个文件区间
+    QByteArray bytes(const ReqifByteRange &range) const; // 拷贝区间内容
+
+    // 在scope内查找下一个本地名为localName的元素（开始标签起点到结束标签末尾），忽略命名空间前缀
+    ReqifByteRange findElement(const QByteArray &localName, const ReqifByteRange &scope) const;
+    // 在scope内查找下一个本地名为localName的开始标签（只返回开始标签区间，不查找结束标签）
+    ReqifByteRange findStartTag(const QByteArray &localName, const ReqifByteRange &scope) const;
+    // 在element的直接子元素中查找本地名为localName的元素（不进入更深层级）
+    ReqifByteRange findChild(const QByteArray &localName, const ReqifByteRange &element) const;
+    // 元素内容区间（开始标签之后到结束标签之前；自闭合元素返回空区间）
+    ReqifByteRange contentRange(const ReqifByteRange &element) const;
+    // 元素开始标签中的属性原始值（未解码实体）
+    QByteArray attribute(const ReqifByteRange &element, const QByteArray &name) const;
+    // 开始标签中属性值的字节区间（不含引号）
+    ReqifByteRange attributeRange(const ReqifByteRange &element, const QByteArray &name) const;
+    // 开始标签中的命名空间声明（xmlns与xmlns:前缀，原始值）
+    ReqifAttributeList namespaceDeclarations(const ReqifByteRange &element) const;
+    // 索引scope内所有localName元素：IDENTIFIER -> 字节区间
+    QHash<QString, ReqifByteRange> indexElements(const QByteArray &localName, const ReqifByteRange &scope) const;
+    // 映射内容的编码：XML声明中的编码（缺省为UTF-8），宽字符编码按BOM识别，转码副本为UTF-8
+    QByteArray encoding() const;
+
+private:
+    qint64 skipMarkup(qint64 pos, qint64 end) const;    // 跳过注释/CDATA/处理指令，返回其后位置
+    qint64 tagEnd(qint64 pos, qint64 end) const;        // 标签结束符'>'之后的位置（跳过引号内内容）
+    int nameLength(qint64 pos, qint64 end, int *localStart) const; // 标签名长度及本地名起点（跳过前缀）
+    bool nameEquals(qint64 pos, qint64 end, const QByteArray &name, bool localOnly) const; // 标签名比较
+
+private:
+    QFile m_file;
+    QScopedPointer<QTemporaryFile> m_transcoded;        // 宽字符编码文件的UTF-8副本（openUtf8）
+    QTextCodec *m_wideCodec = nullptr;
+    const char *m_data = nullptr;
+    qint64 m_size = 0;
+    QString m_errorString;
+};
+
+#endif // REQIFRAWFILE_H
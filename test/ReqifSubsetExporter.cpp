@@ -0,0 +1,270 @@
+﻿#include "ReqifSubsetExporter.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QTextCodec>
+#include <QUuid>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+// 开始标签名的结束位置
+qint64 startTagNameEnd(const char *data, const ReqifByteRange &element) {
+    qint64 i = element.begin + 1;
+    while (i < element.end && !strchr(" \t\r\n/>", data[i])) ++i;
+    return i;
+}
+
+} // namespace
+
+ReqifSubsetExporter::ReqifSubsetExporter(const ReqifParser &parser) : m_parser(parser)
+{
+}
+
+// 导出子树
+bool ReqifSubsetExporter::exportSubtrees(const QStringList &rootIds, const QString &outPath) {
+    m_exportedCount = 0;
+    m_hierarchyCounter = 0;
+    m_errorString.clear();
+
+    if (rootIds.isEmpty()) {
+        m_errorString = u8"未选择要导出的需求";
+        return false;
+    }
+    if (QFileInfo(outPath).canonicalFilePath() == QFileInfo(m_parser.filePath()).canonicalFilePath()) {
+        m_errorString = u8"不能覆盖源文件";
+        return false;
+    }
+    if (!openSource()) return false;
+
+    const bool ok = writeSubset(rootIds, outPath);
+    m_source.close();
+    m_encoder.reset();
+    return ok;
+}
+
+// 映射源文件：UTF-16/UTF-32转为UTF-8副本定位（字节扫描只对ASCII兼容的内容有效），写出时编码回源编码
+bool ReqifSubsetExporter::openSource() {
+    if (!m_source.openUtf8(m_parser.filePath())) {
+        m_errorString = u8"无法读取源文件：" + m_source.errorString();
+        return false;
+    }
+    m_codec = m_source.wideCodec();
+    if (m_codec) {
+        m_encoder.reset(m_codec->makeEncoder(QTextCodec::IgnoreHeader));
+        return true;
+    }
+    m_codec = QTextCodec::codecForName(m_source.encoding());
+    if (!m_codec) {
+        m_errorString = QString(u8"不支持的源文件编码：%1").arg(QString::fromLatin1(m_source.encoding()));
+        m_source.close();
+        return false;
+    }
+    return true;
+}
+
+// 定位区块并写出
+bool ReqifSubsetExporter::writeSubset(const QStringList &rootIds, const QString &outPath) {
+    QElapsedTimer timer;
+    timer.start();
+
+    // 1. 收集子集（多个根存在包含关系时只导出一次）
+    QStringList ids;
+    QSet<QString> subset;
+    QStringList roots;
+    foreach (const QString &rootId, rootIds) {
+        if (subset.contains(rootId)) continue;
+        roots.append(rootId);
+        collectSubtree(rootId, ids, subset);
+    }
+
+    // 2. 定位源文件中的各区块
+    const ReqifByteRange root = m_source.findElement("REQ-IF", m_source.whole());
+    const ReqifByteRange header = m_source.findElement("THE-HEADER", root);
+    const ReqifByteRange coreContent = m_source.findElement("CORE-CONTENT", root);
+    const ReqifByteRange content = m_source.findElement("REQ-IF-CONTENT", coreContent);
+    if (!content.isValid()) {
+        m_errorString = u8"源文件缺少REQ-IF-CONTENT";
+        return false;
+    }
+    const ReqifByteRange datatypes = m_source.findElement("DATATYPES", content);
+    const ReqifByteRange specTypes = m_source.findElement("SPEC-TYPES", content);
+    const ReqifByteRange specObjects = m_source.findElement("SPEC-OBJECTS", content);
+    const ReqifByteRange specifications = m_source.findElement("SPECIFICATIONS", content);
+    const ReqifByteRange firstSpec = m_source.findElement("SPECIFICATION", specifications);
+    const ReqifByteRange specType = m_source.findChild("TYPE", firstSpec); // 只取SPECIFICATION自身的类型引用
+
+    // 拷贝的片段可能使用中间层元素上声明的前缀，写出时补到片段的开始标签上
+    const QList<ReqifByteRange> contentAncestors = QList<ReqifByteRange>() << root << coreContent << content;
+    const ReqifAttributeList contentDecls = inheritedDeclarations(contentAncestors);
+    const ReqifAttributeList objectDecls = inheritedDeclarations(QList<ReqifByteRange>(contentAncestors) << specObjects);
+    const ReqifAttributeList typeDecls = inheritedDeclarations(QList<ReqifByteRange>(contentAncestors) << specifications << firstSpec);
+
+    const QHash<QString, ReqifByteRange> objectRanges = m_source.indexElements("SPEC-OBJECT", specObjects);
+    foreach (const QString &reqId, ids) {
+        if (!objectRanges.contains(reqId)) {
+            m_errorString = QString(u8"源文件中未找到需求对象：%1").arg(reqId);
+            return false;
+        }
+    }
+
+    // 3. 写出
+    QFile outFile(outPath);
+    if (!outFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_errorString = u8"无法写入文件：" + outFile.errorString();
+        return false;
+    }
+    m_device = &outFile;
+    m_namespace = m_parser.reqifNamespace();
+    m_idPrefix = "_" + QUuid::createUuid().toString().mid(1, 36);
+    m_lastChange = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+
+    QXmlStreamWriter writer(&outFile);
+    writer.setAutoFormatting(true);
+    // 拷贝的片段须与输出编码一致
+    writer.setCodec(m_codec);
+    writer.writeStartDocument();
+
+    foreach (const QXmlStreamNamespaceDeclaration &decl, m_parser.namespaceDeclarations()) {
+        if (decl.prefix().isEmpty()) {
+            writer.writeDefaultNamespace(decl.namespaceUri().toString());
+        } else {
+            writer.writeNamespace(decl.namespaceUri().toString(), decl.prefix().toString());
+        }
+    }
+    writer.writeStartElement(m_namespace, "REQ-IF");
+    if (header.isValid()) writeRaw(writer, header, ReqifAttributeList());
+
+    writer.writeStartElement(m_namespace, "CORE-CONTENT");
+    writer.writeStartElement(m_namespace, "REQ-IF-CONTENT");
+    if (datatypes.isValid()) writeRaw(writer, datatypes, contentDecls);
+    if (specTypes.isValid()) writeRaw(writer, specTypes, contentDecls);
+
+    writer.writeStartElement(m_namespace, "SPEC-OBJECTS");
+    foreach (const QString &reqId, ids) {
+        writeRaw(writer, objectRanges.value(reqId), objectDecls);
+    }
+    writer.writeEndElement(); // SPEC-OBJECTS
+
+    writer.writeStartElement(m_namespace, "SPECIFICATIONS");
+    writer.writeStartElement(m_namespace, "SPECIFICATION");
+    writer.writeAttribute("IDENTIFIER", m_idPrefix);
+    writer.writeAttribute("LAST-CHANGE", m_lastChange);
+    writer.writeAttribute("LONG-NAME", QFileInfo(outPath).completeBaseName());
+    if (specType.isValid()) writeRaw(writer, specType, typeDecls);
+    writer.writeStartElement(m_namespace, "CHILDREN");
+    foreach (const QString &rootId, roots) {
+        if (subset.remove(rootId)) writeHierarchy(writer, rootId, subset);
+    }
+    writer.writeEndElement(); // CHILDREN
+    writer.writeEndElement(); // SPECIFICATION
+    writer.writeEndElement(); // SPECIFICATIONS
+
+    writer.writeEndElement(); // REQ-IF-CONTENT
+    writer.writeEndElement(); // CORE-CONTENT
+    writer.writeEndElement(); // REQ-IF
+    writer.writeEndDocument();
+
+    m_device = nullptr;
+    if (writer.hasError() || outFile.error() != QFileDevice::NoError) {
+        m_errorString = u8"写入文件失败：" + outFile.errorString();
+        return false;
+    }
+
+    m_exportedCount = ids.size();
+    qDebug() << u8"子集导出完成 | 需求：" << m_exportedCount << u8"耗时(ms)：" << timer.elapsed();
+    return true;
+}
+
+int ReqifSubsetExporter::exportedCount() const {
+    return m_exportedCount;
+}
+
+QString ReqifSubsetExporter::errorString() const {
+    return m_errorString;
+}
+
+// 收集子树（深度优先，与层次顺序一致）
+void ReqifSubsetExporter::collectSubtree(const QString &reqId, QStringList &ids, QSet<QString> &seen) const {
+    if (seen.contains(reqId)) return; // 避免循环引用
+    seen.insert(reqId);
+    ids.append(reqId);
+    foreach (const QString &childId, m_parser.getChildIds(reqId)) {
+        collectSubtree(childId, ids, seen);
+    }
+}
+
+// 重建层次：每个需求对应一个SPEC-HIERARCHY（pending中为尚未写出的需求，防止循环引用重复写出）
+void ReqifSubsetExporter::writeHierarchy(QXmlStreamWriter &writer, const QString &reqId, QSet<QString> &pending) {
+    writer.writeStartElement(m_namespace, "SPEC-HIERARCHY");
+    writer.writeAttribute("IDENTIFIER", nextHierarchyId());
+    writer.writeAttribute("LAST-CHANGE", m_lastChange);
+    writer.writeStartElement(m_namespace, "OBJECT");
+    writer.writeTextElement(m_namespace, "SPEC-OBJECT-REF", reqId);
+    writer.writeEndElement(); // OBJECT
+
+    const QStringList childIds = m_parser.getChildIds(reqId);
+    if (!childIds.isEmpty()) {
+        writer.writeStartElement(m_namespace, "CHILDREN");
+        foreach (const QString &childId, childIds) {
+            if (pending.remove(childId)) writeHierarchy(writer, childId, pending);
+        }
+        writer.writeEndElement(); // CHILDREN
+    }
+    writer.writeEndElement(); // SPEC-HIERARCHY
+}
+
+// 祖先元素上的命名空间声明（内层覆盖外层）；与根元素相同的声明已在输出根元素上，不再重复
+ReqifAttributeList ReqifSubsetExporter::inheritedDeclarations(const QList<ReqifByteRange> &ancestors) const {
+    ReqifAttributeList result;
+    for (int i = 1; i < ancestors.size(); ++i) {
+        foreach (const auto &decl, m_source.namespaceDeclarations(ancestors.at(i))) {
+            int k = 0;
+            while (k < result.size() && result.at(k).first != decl.first) ++k;
+            if (k < result.size()) result[k] = decl; else result.append(decl);
+        }
+    }
+    const ReqifAttributeList rootDecls = m_source.namespaceDeclarations(ancestors.value(0));
+    for (int k = result.size() - 1; k >= 0; --k) {
+        if (rootDecls.contains(result.at(k))) result.removeAt(k);
+    }
+    return result;
+}
+
+// 拷贝元素（先让写入器闭合未完成的开始标签），元素自身未声明的继承前缀插入到开始标签名之后
+void ReqifSubsetExporter::writeRaw(QXmlStreamWriter &writer, const ReqifByteRange &range,
+                                   const ReqifAttributeList &inherited) {
+    writer.writeCharacters(QString());
+    writeSource("\n", 1);
+
+    const char *data = m_source.data();
+    const qint64 nameEnd = startTagNameEnd(data, range);
+    writeSource(data + range.begin, nameEnd - range.begin);
+    const ReqifAttributeList own = m_source.namespaceDeclarations(range);
+    foreach (const auto &decl, inherited) {
+        bool declared = false;
+        foreach (const auto &ownDecl, own) {
+            declared = declared || ownDecl.first == decl.first;
+        }
+        if (declared) continue;
+        const QByteArray attribute = " " + decl.first + "=\"" + decl.second + "\"";
+        writeSource(attribute.constData(), attribute.size());
+    }
+    writeSource(data + nameEnd, range.end - nameEnd);
+}
+
+// 按输出编码写出源字节：ASCII兼容编码原样拷贝，UTF-8副本编码回源编码
+void ReqifSubsetExporter::writeSource(const char *data, qint64 size) {
+    if (m_encoder) {
+        m_device->write(m_encoder->fromUnicode(QString::fromUtf8(data, int(size))));
+    } else {
+        m_device->write(data, size);
+    }
+}
+
+// 生成SPEC-HIERARCHY标识
+QString ReqifSubsetExporter::nextHierarchyId() {
+    return QString("%1-h%2").arg(m_idPrefix).arg(++m_hierarchyCounter);
+}
@@ -0,0 +1,49 @@
+﻿#ifndef REQIFSUBSETEXPORTER_H
+#define REQIFSUBSETEXPORTER_H
+
+#include <QString>
+#include <QStringList>
+#include <QSet>
+#include <QScopedPointer>
+#include <QTextCodec>
+#include <QXmlStreamWriter>
+#include "ReqifParser.h"
+#include "ReqifRawFile.h"
+
+// 子集导出：将若干子树写成独立的ReqIF文件
+// 数据类型、规格类型和SPEC-OBJECT按源文件字节原样拷贝，仅重建SPEC-HIERARCHY
+// 输出与源文件编码相同；UTF-16/UTF-32源文件先转为UTF-8临时副本定位，写出时再编码回源编码
+class ReqifSubsetExporter
+{
+public:
+    explicit ReqifSubsetExporter(const ReqifParser &parser);
+
+    bool exportSubtrees(const QStringList &rootIds, const QString &outPath); // 导出子树（含全部后代）
+    int exportedCount() const;                          // 已导出的需求数
+    QString errorString() const;                        // 失败原因
+
+private:
+    bool openSource();                                  // 映射源文件并确定编码
+    bool writeSubset(const QStringList &rootIds, const QString &outPath); // 定位区块并写出
+    void collectSubtree(const QString &reqId, QStringList &ids, QSet<QString> &seen) const; // 收集子树（深度优先）
+    void writeHierarchy(QXmlStreamWriter &writer, const QString &reqId, QSet<QString> &pending); // 重建层次
+    ReqifAttributeList inheritedDeclarations(const QList<ReqifByteRange> &ancestors) const; // 祖先元素上的命名空间声明
+    void writeRaw(QXmlStreamWriter &writer, const ReqifByteRange &range, const ReqifAttributeList &inherited); // 拷贝元素
+    void writeSource(const char *data, qint64 size);    // 按输出编码写出源字节
+    QString nextHierarchyId();                          // 生成SPEC-HIERARCHY标识
+
+private:
+    const ReqifParser &m_parser;
+    ReqifRawFile m_source;                              // 源文件字节（或其UTF-8副本）
+    QTextCodec *m_codec = nullptr;                      // 源文件（即输出）编码
+    QScopedPointer<QTextEncoder> m_encoder;             // 使用UTF-8副本时，将拷贝内容编码回源编码
+    QIODevice *m_device = nullptr;                      // 输出设备
+    QString m_namespace;                                // ReqIF命名空间
+    QString m_idPrefix;                                 // 新建元素标识前缀
+    QString m_lastChange;                               // 新建元素的LAST-CHANGE
+    int m_hierarchyCounter = 0;
+    int m_exportedCount = 0;
+    QString m_errorString;
+};
+
+#endif // REQIFSUBSETEXPORTER_H
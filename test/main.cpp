@@ -1,6 +1,17 @@
 ﻿#include "MainWindow.h"
+#include "ReqQueryServer.h"
+#include "ReqQueryProtocol.h"
+#include "ReqRecordWriter.h"
+#include "ReqAllocCounter.h"
 #include <QApplication>
 #include <QTextCodec>
+#include <QDebug>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 
 
 bool AppstreServer::SaveFile(const QString& strDIr, const& strFileName, const QBayteArray& data)
@@ -23,7 +34,183 @@ bool AppstreServer::SaveFile(const QString& strDIr, const& strFileName, const QB
 
 }
 
+// 守护进程模式：test --daemon [--name 服务名] 文件1.reqif 文件2.reqif ...
+static int runQueryDaemon(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QTextCodec::setCodecForLocale(QTextCodec::codecForName(u8"UTF-8"));
+
+    QString serverName = ReqQueryProtocol::defaultServerName();
+    QStringList files;
+    const QStringList args = app.arguments().mid(1);
+    for (int i = 0; i < args.size(); ++i) {
+        if (args.at(i) == "--daemon") continue;
+        if (args.at(i) == "--name" && i + 1 < args.size()) {
+            serverName = args.at(++i);
+            continue;
+        }
+        files.append(args.at(i));
+    }
+
+    ReqQueryServer server;
+    foreach (const QString &file, files) {
+        if (!server.openDocument(file)) {
+            qWarning() << u8"加载失败：" << file << server.errorString();
+        }
+    }
+    if (!server.listen(serverName)) {
+        qWarning() << u8"查询服务启动失败：" << server.errorString();
+        return 1;
+    }
+    return app.exec();
+}
+
+// 流式导出模式：test --export 输入.reqif 输出.ndjson|csv|json（边解析边写出，不建立需求存储）
+static int runStreamExport(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QTextCodec::setCodecForLocale(QTextCodec::codecForName(u8"UTF-8"));
+
+    const QStringList args = app.arguments();
+    const int index = args.indexOf("--export");
+    if (index + 2 >= args.size()) {
+        qWarning() << u8"用法：--export 输入.reqif 输出.ndjson|csv|json";
+        return 2;
+    }
+    const QString outPath = args.at(index + 2);
+    QFile outFile(outPath);
+    if (!outFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << u8"无法写入文件：" << outFile.errorString();
+        return 1;
+    }
+
+    ReqifParser parser;
+    parser.setInteractive(false);
+    ReqRecordWriter writer(&outFile, ReqRecordWriter::formatForFile(outPath));
+    if (!parser.streamTo(args.at(index + 1), writer)) {
+        qWarning() << u8"导出失败：" << parser.errorString();
+        return 1;
+    }
+    qDebug() << u8"已导出需求：" << writer.recordCount();
+    return 0;
+}
+
+// 基准测试模式：test --bench 输入.reqif [--repeat N]
+// 报告加载耗时、每个需求的堆分配次数以及释放耗时（主线程耗时与后台释放完成的总耗时）
+static int runBenchmark(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QTextCodec::setCodecForLocale(QTextCodec::codecForName(u8"UTF-8"));
+
+    const QStringList args = app.arguments();
+    const int index = args.indexOf("--bench");
+    if (index + 1 >= args.size()) {
+        qWarning() << u8"用法：--bench 输入.reqif [--repeat N]";
+        return 2;
+    }
+    const QString filePath = args.at(index + 1);
+    const int repeatIndex = args.indexOf("--repeat");
+    const int repeat = repeatIndex > 0 && repeatIndex + 1 < args.size()
+                       ? qMax(1, args.at(repeatIndex + 1).toInt()) : 1;
+
+    for (int run = 1; run <= repeat; ++run) {
+        ReqifParser *parser = new ReqifParser;
+        parser->setInteractive(false);
+
+        QElapsedTimer timer;
+        ReqAllocCounter::start();
+        timer.start();
+        const bool ok = parser->load(filePath);
+        const qint64 loadMs = timer.elapsed();
+        const qint64 allocations = ReqAllocCounter::stop();
+        if (!ok) {
+            qWarning() << u8"加载失败：" << parser->errorString();
+            delete parser;
+            return 1;
+        }
+        const int reqCount = parser->getAllReqCount();
+
+        timer.restart();
+        delete parser;
+        const qint64 releaseMs = timer.elapsed();
+        QThreadPool::globalInstance()->waitForDone(); // 等待后台释放完成
+        const qint64 releaseTotalMs = timer.elapsed();
+
+        QString allocText = u8"不可用（需基准构建CONFIG+=bench或MSVC调试版）";
+        if (allocations >= 0) {
+            allocText = QString(u8"%1（每个需求%2）").arg(allocations)
+                        .arg(reqCount > 0 ? double(allocations) / reqCount : 0.0, 0, 'f', 1);
+        }
+        qDebug().noquote() << QString(u8"第%1次：需求%2，加载%3 ms，堆分配%4，释放%5 ms（后台完成%6 ms）")
+                              .arg(run).arg(reqCount).arg(loadMs).arg(allocText)
+                              .arg(releaseMs).arg(releaseTotalMs);
+    }
+    return 0;
+}
+
+// 完整性检查模式：test --check 输入.reqif [--strict]
+// 向标准输出写出JSON报告；无问题返回0，有问题或加载失败返回1（严格模式下发现第一个问题即停止）
+static int runIntegrityCheck(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QTextCodec::setCodecForLocale(QTextCodec::codecForName(u8"UTF-8"));
+
+    const QStringList args = app.arguments();
+    const int index = args.indexOf("--check");
+    if (index + 1 >= args.size()) {
+        qWarning() << u8"用法：--check 输入.reqif [--strict]";
+        return 2;
+    }
+    const QString filePath = args.at(index + 1);
+
+    ReqifParser parser;
+    parser.setInteractive(false);
+    parser.setStrict(args.contains("--strict"));
+    QElapsedTimer timer;
+    timer.start();
+    const bool loaded = parser.load(filePath);
+
+    QJsonObject counts;
+    QJsonArray items;
+    foreach (const ReqDiagnostic &diagnostic, parser.diagnostics()) {
+        counts[diagnostic.kindName()] = counts.value(diagnostic.kindName()).toInt() + 1;
+        QJsonObject item;
+        item["kind"] = diagnostic.kindName();
+        item["id"] = diagnostic.reqId;
+        item["detail"] = diagnostic.detail;
+        item["line"] = diagnostic.line;
+        item["message"] = diagnostic.toString();
+        items.append(item);
+    }
+    QJsonObject report;
+    report["file"] = filePath;
+    report["strict"] = parser.strict();
+    report["loaded"] = loaded;
+    report["error"] = parser.errorString();
+    report["requirements"] = parser.getAllReqCount();
+    report["total"] = parser.diagnosticCount();
+    report["counts"] = counts;
+    report["diagnostics"] = items;
+    report["elapsedMs"] = timer.elapsed();
+
+    QFile out;
+    out.open(stdout, QIODevice::WriteOnly);
+    out.write(QJsonDocument(report).toJson(QJsonDocument::Indented));
+    return loaded && parser.diagnosticCount() == 0 ? 0 : 1;
+}
+
 int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--daemon") == 0) {
+            return runQueryDaemon(argc, argv);
+        }
+        if (qstrcmp(argv[i], "--export") == 0) {
+            return runStreamExport(argc, argv);
+        }
+        if (qstrcmp(argv[i], "--bench") == 0) {
+            return runBenchmark(argc, argv);
+        }
+        if (qstrcmp(argv[i], "--check") == 0) {
+            return runIntegrityCheck(argc, argv);
+        }
+    }
+
     QApplication a(argc, argv);
 
     // 强制UTF-8编码，避免中文乱码
@@ -1,24 +1,42 @@
 ﻿#include "MainWindow.h"
 #include "ui_MainWindow.h"
+#include "ReqifSubsetExporter.h"
+#include "ReqRecordWriter.h"
+#include "ReqRenderCache.h"
 #include <QMenuBar>
 #include <QFileDialog>
+#include <QFile>
 #include <QMessageBox>
 #include <QSplitter>
 #include <QFont>
 #include <QStatusBar>
 #include <QToolBar>
 #include <QAction>
+#include <QElapsedTimer>
+#include <QDesktopServices>
+#include <QFileInfo>
+#include <QUrl>
+#include <QTextDocument>
+#include <QInputDialog>
+#include <QTreeWidgetItemIterator>
+#include <QActionGroup>
+#include <QPushButton>
+#include <QTextStream>
+#include <QDebug>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow) {
     ui->setupUi(this);
+    m_renderCache = new ReqRenderCache(nullptr, this);
     setWindowTitle(u8"ReqIF需求查看器");
     resize(1000, 600);
     initUI();
 }
 
 MainWindow::~MainWindow() {
+    releaseShownDocument(false);
+    m_renderCache->setParser(nullptr);
     delete ui;
 }
 
@@ -42,6 +60,10 @@ void MainWindow::initUI() {
     m_descBrowser->setFont(descFont);
     m_descBrowser->setStyleSheet("background-color: #f8f8f8; padding: 15px;");
     m_descBrowser->setPlaceholderText(u8"点击左侧需求节点查看描述");
+    m_descBrowser->setOpenLinks(false); // 附件链接交给系统程序打开
+    connect(m_descBrowser, &QTextBrowser::anchorClicked, [](const QUrl &url) {
+        QDesktopServices::openUrl(url);
+    });
 
     splitter->setSizes({300, 700});
     setCentralWidget(splitter);
@@ -55,46 +77,122 @@ void MainWindow::initUI() {
     QAction *loadAction = fileMenu->addAction(u8"加载.reqif文件");
     loadAction->setShortcut(QKeySequence::Open);
     connect(loadAction, &QAction::triggered, this, &MainWindow::onLoadFile);
+    QAction *closeAllAction = fileMenu->addAction(u8"关闭全部文件");
+    connect(closeAllAction, &QAction::triggered, this, &MainWindow::onCloseAll);
+    QAction *exportAction = fileMenu->addAction(u8"导出需求数据...");
+    connect(exportAction, &QAction::triggered, this, &MainWindow::onExportRecords);
+
+    // 视图菜单
+    QMenu *viewMenu = menuBar()->addMenu(u8"视图");
+    QAction *richTextAction = viewMenu->addAction(u8"富文本描述");
+    richTextAction->setCheckable(true);
+    richTextAction->setChecked(false);
+    connect(richTextAction, &QAction::toggled, this, &MainWindow::onToggleRichText);
+    QAction *lazyAction = viewMenu->addAction(u8"按规格延迟加载");
+    lazyAction->setCheckable(true);
+    lazyAction->setChecked(true);
+    m_workspace.setLazyLoading(true); // 只关心部分规格时无需解析整个文件
+    connect(lazyAction, &QAction::toggled, this, &MainWindow::onToggleLazyLoading);
+    QAction *outOfCoreAction = viewMenu->addAction(u8"超大文件模式（磁盘索引）");
+    outOfCoreAction->setCheckable(true);
+    outOfCoreAction->setChecked(false);
+    outOfCoreAction->setStatusTip(u8"浏览时内存占用与文件大小无关；首次建立索引时需在内存中保留全部需求ID（约每百万需求150MB）");
+    connect(outOfCoreAction, &QAction::toggled, this, &MainWindow::onToggleOutOfCore);
+    QAction *budgetAction = viewMenu->addAction(u8"内存预算...");
+    connect(budgetAction, &QAction::triggered, this, &MainWindow::onSetMemoryBudget);
+
+    // 无层次结构时的推断规则
+    QMenu *ruleMenu = viewMenu->addMenu(u8"层次推断规则");
+    QActionGroup *ruleGroup = new QActionGroup(this);
+    const QList<QPair<QString, ReqifParser::HierarchyRule>> rules = {
+        qMakePair(QString(u8"自动（优先章节号）"), ReqifParser::InferAuto),
+        qMakePair(QString(u8"按章节号"), ReqifParser::InferFromOutline),
+        qMakePair(QString(u8"按排序号位数"), ReqifParser::InferFromSortNumber),
+        qMakePair(QString(u8"不推断"), ReqifParser::InferNone)
+    };
+    for (const auto &rule : rules) {
+        QAction *ruleAction = ruleMenu->addAction(rule.first);
+        ruleAction->setCheckable(true);
+        ruleAction->setChecked(rule.second == ReqifParser::InferAuto);
+        ruleGroup->addAction(ruleAction);
+        const ReqifParser::HierarchyRule value = rule.second;
+        connect(ruleAction, &QAction::triggered, [this, value]() {
+            m_workspace.setHierarchyRule(value);
+            reopenAll();
+        });
+    }
 
     // 过滤菜单
     QMenu *filterMenu = menuBar()->addMenu(u8"过滤");
     QAction *techReqAction = filterMenu->addAction(u8"显示技术要求");
     connect(techReqAction, &QAction::triggered, this, &MainWindow::onShowTechnicalRequirements);
+    QAction *findIdAction = filterMenu->addAction(u8"按ID查找需求...");
+    findIdAction->setShortcut(QKeySequence::Find);
+    connect(findIdAction, &QAction::triggered, this, &MainWindow::onFindReqById);
 
     // 工具栏按钮
     QAction *showAllAction = toolBar->addAction(u8"显示全部");
     QAction *techFilterAction = toolBar->addAction(u8"技术要求");
 
     connect(showAllAction, &QAction::triggered, [this]() {
-        m_parser.fillTree(m_treeWidget);
+        m_filterText.clear();
+        m_workspace.fillTree(m_treeWidget);
         statusBar()->showMessage(u8"显示所有需求", 3000);
     });
 
     connect(techFilterAction, &QAction::triggered, this, &MainWindow::onShowTechnicalRequirements);
     connect(m_treeWidget, &QTreeWidget::itemClicked, this, &MainWindow::onReqItemClicked);
+    connect(m_treeWidget, &QTreeWidget::itemExpanded, this, &MainWindow::onTreeItemExpanded);
 
+    // 右键菜单
+    m_treeWidget->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_treeWidget->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(m_treeWidget, &QTreeWidget::customContextMenuRequested, this, &MainWindow::onTreeContextMenu);
+
+    // 文件重新导出后自动增量更新（工作区中的文档均已启用监视）
+    connect(&m_workspace, &ReqWorkspace::reqsChanged, this, &MainWindow::onReqsChanged);
+    connect(&m_workspace, &ReqWorkspace::reloadFailed, this, &MainWindow::onReloadFailed);
+
+    m_memoryLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(m_memoryLabel);
     statusBar()->showMessage(u8"就绪");
 }
 
 void MainWindow::onLoadFile() {
-    QString filePath = QFileDialog::getOpenFileName(
+    QStringList filePaths = QFileDialog::getOpenFileNames(
         this, u8"选择ReqIF文件", "",
         u8"ReqIF文件 (*.reqif);;所有文件 (*.*)"
     );
-    if (filePath.isEmpty()) return;
+    if (filePaths.isEmpty()) return;
 
     statusBar()->showMessage(u8"正在解析文件...");
 
-    if (m_parser.load(filePath)) {
-        m_parser.fillTree(m_treeWidget);
-        int totalCount = m_parser.getAllReqCount();
-        int validCount = m_parser.getValidReqCount();
+    // 已打开的文件会被重新加载，先取下正在显示的文档
+    releaseShownDocument(false);
+    m_renderCache->setParser(nullptr);
+
+    QElapsedTimer timer;
+    timer.start();
+    const int loaded = m_workspace.open(filePaths);
+    m_filterText.clear();
+    m_workspace.fillTree(m_treeWidget);
 
-        QString message = QString(u8"加载完成，共解析 %1 条需求，其中有效需求 %2 条")
+    if (loaded > 0) {
+        int totalCount = m_workspace.reqCount();
+        int validCount = m_workspace.validReqCount();
+
+        QString message = QString(u8"加载完成（%1 个文件，耗时 %2 毫秒），共 %3 条需求，其中有效需求 %4 条")
+                         .arg(m_workspace.documents().size()).arg(timer.elapsed())
                          .arg(totalCount).arg(validCount);
+        if (m_workspace.diagnosticCount() > 0) {
+            message += QString(u8"；发现 %1 个完整性问题（重复ID、悬空引用等）").arg(m_workspace.diagnosticCount());
+        }
         statusBar()->showMessage(message, 5000);
+        if (m_workspace.diagnosticCount() > 0) {
+            showDiagnostics();
+        }
 
-        if (validCount == 0) {
+        if (validCount == 0 && !m_workspace.lazyLoading()) {
             QMessageBox::warning(this, u8"警告",
                                  u8"文件加载成功，但没有找到有效需求。\n"
                                  u8"可能原因：\n"
@@ -104,20 +202,142 @@ void MainWindow::onLoadFile() {
         }
     } else {
         statusBar()->showMessage(u8"文件解析失败", 5000);
-        QMessageBox::critical(this, u8"失败", u8"文件解析失败，请检查文件格式");
+    }
+    updateMemoryStatus();
+    if (!m_workspace.errors().isEmpty()) {
+        QMessageBox::critical(this, u8"失败", u8"以下文件解析失败，请检查文件格式：\n" +
+                              m_workspace.errors().join('\n'));
+    }
+}
+
+// 完整性问题汇总：消息框详情中只列出前若干条，完整列表可保存为报告文件
+void MainWindow::showDiagnostics() {
+    const int previewLimit = 200;
+    QStringList preview;
+    foreach (ReqifParser *document, m_workspace.documents()) {
+        const QString fileName = QFileInfo(document->filePath()).fileName();
+        foreach (const ReqDiagnostic &diagnostic, document->diagnostics()) {
+            if (preview.size() >= previewLimit) break;
+            preview.append(fileName + u8"：" + diagnostic.toString());
+        }
+    }
+    const int total = m_workspace.diagnosticCount();
+    if (total > preview.size()) {
+        preview.append(QString(u8"……其余 %1 个问题请保存报告查看").arg(total - preview.size()));
+    }
+
+    QMessageBox box(QMessageBox::Warning, u8"完整性问题",
+                    QString(u8"文件中发现 %1 个完整性问题（重复ID、悬空引用等），需求可能显示不完整。").arg(total),
+                    QMessageBox::Ok, this);
+    box.setDetailedText(preview.join('\n'));
+    QPushButton *saveButton = box.addButton(u8"保存报告...", QMessageBox::ActionRole);
+    box.exec();
+    if (box.clickedButton() != saveButton) return;
+
+    const QString filePath = QFileDialog::getSaveFileName(this, u8"保存完整性报告", "", u8"文本文件 (*.txt)");
+    if (filePath.isEmpty()) return;
+    if (saveDiagnosticReport(filePath)) {
+        statusBar()->showMessage(u8"完整性报告已保存：" + filePath, 5000);
+    } else {
+        QMessageBox::critical(this, u8"保存失败", u8"无法写入文件：" + filePath);
+    }
+}
+
+// 保存全部文档的完整性问题（每个文档最多保留ReqifParser::MaxDiagnostics条）
+bool MainWindow::saveDiagnosticReport(const QString &filePath) const {
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) return false;
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+    foreach (ReqifParser *document, m_workspace.documents()) {
+        if (document->diagnosticCount() == 0) continue;
+        out << document->filePath() << QString(u8"（%1 个问题）").arg(document->diagnosticCount()) << '\n';
+        foreach (const ReqDiagnostic &diagnostic, document->diagnostics()) {
+            out << "  [" << diagnostic.kindName() << "] " << diagnostic.toString() << '\n';
+        }
+        if (document->diagnosticCount() > document->diagnostics().size()) {
+            out << QString(u8"  ……另有 %1 个问题未保留").arg(document->diagnosticCount() - document->diagnostics().size())
+                << '\n';
+        }
+    }
+    out.flush();
+    return file.error() == QFileDevice::NoError;
+}
+
+void MainWindow::onCloseAll() {
+    releaseShownDocument(false);
+    m_renderCache->setParser(nullptr);
+    m_workspace.clear();
+    m_treeWidget->clear();
+    updateMemoryStatus();
+    statusBar()->showMessage(u8"已关闭全部文件", 3000);
+}
+
+// 按ID跨文件查找需求，定位到首个包含该需求的文档中的节点
+void MainWindow::onFindReqById() {
+    bool ok = false;
+    const QString reqId = QInputDialog::getText(this, u8"按ID查找需求", u8"需求ID：",
+                                                QLineEdit::Normal, QString(), &ok).trimmed();
+    if (!ok || reqId.isEmpty()) return;
+
+    const QList<ReqifParser*> documents = m_workspace.documentsContaining(reqId);
+    if (documents.isEmpty()) {
+        statusBar()->showMessage(QString(u8"未找到需求：%1").arg(reqId), 3000);
+        return;
+    }
+
+    for (QTreeWidgetItemIterator it(m_treeWidget); *it; ++it) {
+        if ((*it)->data(0, Qt::UserRole).toString() == reqId &&
+            m_workspace.documentForItem(*it) == documents.first()) {
+            m_treeWidget->setCurrentItem(*it);
+            m_treeWidget->scrollToItem(*it);
+            break;
+        }
+    }
+    showDescription(documents.first(), reqId);
+
+    QStringList names;
+    foreach (ReqifParser *document, documents) {
+        names.append(QFileInfo(document->filePath()).fileName());
+    }
+    statusBar()->showMessage(QString(u8"需求 %1 出现在：%2").arg(reqId, names.join(u8"、")), 5000);
+}
+
+void MainWindow::onExportRecords() {
+    ReqifParser *document = currentDocument();
+    if (!document) {
+        QMessageBox::information(this, u8"提示", u8"请先加载ReqIF文件并选择要导出的文件");
+        return;
+    }
+
+    QString filePath = QFileDialog::getSaveFileName(
+        this, u8"导出需求数据", "",
+        u8"NDJSON文件 (*.ndjson);;CSV文件 (*.csv);;JSON文件 (*.json)"
+    );
+    if (filePath.isEmpty()) return;
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QMessageBox::critical(this, u8"导出失败", u8"无法写入文件：" + file.errorString());
+        return;
+    }
+    ReqRecordWriter writer(&file, ReqRecordWriter::formatForFile(filePath));
+    if (document->writeRecords(writer)) {
+        statusBar()->showMessage(QString(u8"已导出 %1 条需求").arg(writer.recordCount()), 5000);
+    } else {
+        QMessageBox::critical(this, u8"导出失败", writer.errorString());
     }
 }
 
 void MainWindow::onShowTechnicalRequirements() {
-    if (m_parser.getAllReqCount() == 0) {
+    if (m_workspace.reqCount() == 0) {
         QMessageBox::information(this, u8"提示", u8"请先加载ReqIF文件");
         return;
     }
 
     // 过滤显示技术要求相关的内容
-    m_parser.fillTreeWithFilter(m_treeWidget, u8"技术");
-
-    int visibleCount = m_treeWidget->topLevelItemCount();
+    m_filterText = u8"技术";
+    int visibleCount = m_workspace.fillTreeWithFilter(m_treeWidget, m_filterText);
     if (visibleCount > 0) {
         statusBar()->showMessage(QString(u8"显示 %1 条技术要求相关需求").arg(visibleCount), 3000);
     } else {
@@ -128,7 +348,266 @@ void MainWindow::onShowTechnicalRequirements() {
 void MainWindow::onReqItemClicked(QTreeWidgetItem *item, int column) {
     Q_UNUSED(column);
     if (!item) return;
+    if (!item->data(0, ReqifParser::IndexContinueRole).isNull()) {
+        // 超大文件模式的"加载更多"节点：替换为下一批需求
+        ReqifParser *document = m_workspace.documentForItem(item);
+        if (document) document->fillIndexItem(item);
+        updateMemoryStatus();
+        return;
+    }
     QString reqId = item->data(0, Qt::UserRole).toString();
-    QString description = m_parser.getReqDescription(reqId);
-    m_descBrowser->setPlainText(description);
+    if (reqId.isEmpty()) return;
+    showDescription(m_workspace.documentForItem(item), reqId);
+}
+
+// 当前节点所属文档（只有一个文档时取该文档）
+ReqifParser *MainWindow::currentDocument() const {
+    ReqifParser *document = m_workspace.documentForItem(m_treeWidget->currentItem());
+    if (!document && m_workspace.documents().size() == 1) {
+        document = m_workspace.documents().first();
+    }
+    return document;
+}
+
+// 显示需求描述：文档从渲染缓存取出，切换时归还上一个，并预渲染相邻需求
+void MainWindow::showDescription(ReqifParser *document, const QString &reqId) {
+    if (!document) return;
+    if (document != m_renderCache->parser()) {
+        // 渲染缓存只对应一个文档，切换文档时先取下旧文档的描述
+        releaseShownDocument(false);
+        m_renderCache->setParser(document);
+    }
+    if (reqId == m_shownReqId && m_shownDoc) return;
+
+    QTextDocument *doc = m_renderCache->take(reqId);
+    doc->setDefaultFont(m_descBrowser->font());
+    m_descBrowser->setDocument(doc);
+
+    if (m_shownDoc) {
+        m_renderCache->give(m_shownReqId, m_shownDoc);
+    }
+    m_shownReqId = reqId;
+    m_shownDoc = doc;
+
+    prefetchNeighbors(reqId);
+}
+
+// 取下当前显示的文档，描述框换回自有的空文档
+void MainWindow::releaseShownDocument(bool keep) {
+    if (!m_shownDoc) return;
+    m_descBrowser->setDocument(nullptr);
+    if (keep) {
+        m_renderCache->give(m_shownReqId, m_shownDoc);
+    } else {
+        delete m_shownDoc;
+    }
+    m_shownDoc = nullptr;
+    m_shownReqId.clear();
+}
+
+// 预渲染相邻需求：前后各16个兄弟节点，以及最多32个子节点
+void MainWindow::prefetchNeighbors(const QString &reqId) {
+    const int siblingRange = 16;
+    const int childLimit = 32;
+
+    ReqifParser *document = m_renderCache->parser();
+    ReqData req;
+    if (!document || document->outOfCore() || !document->getReq(reqId, req)) return; // 超大文件模式兄弟列表可能极长，不预渲染
+    const QStringList siblings = req.parentId.isEmpty() ? document->getTopReqIds()
+                                                        : document->getChildIds(req.parentId);
+    const int index = siblings.indexOf(reqId);
+
+    QStringList ids;
+    for (int i = 1; i <= siblingRange && index >= 0; ++i) {
+        if (index + i < siblings.size()) ids.append(siblings.at(index + i));
+        if (index - i >= 0) ids.append(siblings.at(index - i));
+    }
+    ids += document->getChildIds(reqId).mid(0, childLimit);
+    m_renderCache->prefetch(ids);
+}
+
+void MainWindow::onReqsChanged(ReqifParser *document, const ReqChangeSet &changes) {
+    if (m_filterText.isEmpty()) {
+        document->updateTreeItems(m_workspace.documentItem(m_treeWidget, document), changes);
+    } else {
+        m_workspace.fillTreeWithFilter(m_treeWidget, m_filterText); // 过滤结果只含匹配项及其上下文，局部更新无法保持，重新过滤
+    }
+
+    // 当前查看的需求内容变化时刷新描述
+    if (document == m_renderCache->parser()) {
+        m_renderCache->clear();
+        const QString shownId = m_shownReqId;
+        if (changes.changed.contains(shownId)) {
+            releaseShownDocument(false);
+            showDescription(document, shownId);
+        } else if (changes.removed.contains(shownId)) {
+            releaseShownDocument(false);
+        }
+    }
+    updateMemoryStatus();
+
+    statusBar()->showMessage(QString(u8"%1 已更新：新增 %2 条，删除 %3 条，修改 %4 条，移动 %5 条")
+                             .arg(QFileInfo(document->filePath()).fileName())
+                             .arg(changes.added.size()).arg(changes.removed.size())
+                             .arg(changes.changed.size()).arg(changes.moved.size()), 5000);
+}
+
+// 切换富文本描述：需重新解析以保留或丢弃XHTML结构
+void MainWindow::onToggleRichText(bool enabled) {
+    m_workspace.setKeepRichText(enabled);
+    reopenAll();
+}
+
+// 切换按规格延迟加载
+void MainWindow::onToggleLazyLoading(bool enabled) {
+    m_workspace.setLazyLoading(enabled);
+    reopenAll();
+}
+
+// 切换超大文件模式：需求写入磁盘索引，需求树按需分批填充
+void MainWindow::onToggleOutOfCore(bool enabled) {
+    m_workspace.setOutOfCore(enabled);
+    reopenAll();
+}
+
+// 按当前设置重新加载全部文件
+void MainWindow::reopenAll() {
+    const QStringList filePaths = m_workspace.filePaths();
+    if (filePaths.isEmpty()) return;
+
+    ReqifParser *shownDocument = m_shownDoc ? m_renderCache->parser() : nullptr;
+    const QString shownPath = shownDocument ? shownDocument->filePath() : QString();
+    const QString reqId = m_shownReqId;
+    releaseShownDocument(false);
+    m_renderCache->setParser(nullptr);
+    if (m_workspace.open(filePaths) == 0) {
+        statusBar()->showMessage(u8"文件解析失败", 5000);
+    }
+    m_filterText.clear();
+    m_workspace.fillTree(m_treeWidget);
+    updateMemoryStatus();
+
+    ReqifParser *document = m_workspace.document(shownPath);
+    ReqData req;
+    if (document && document->getReq(reqId, req)) {
+        showDescription(document, reqId);
+    }
+}
+
+// 展开未加载的规格：解析该规格的层次结构及其引用的需求
+// 超大文件模式的需求节点：从磁盘索引填充第一批子需求
+void MainWindow::onTreeItemExpanded(QTreeWidgetItem *item) {
+    if (!item->data(0, ReqifParser::IndexRecordRole).isNull() && item->childCount() == 0) {
+        ReqifParser *document = m_workspace.documentForItem(item);
+        if (document) document->fillIndexItem(item);
+        updateMemoryStatus();
+        return;
+    }
+    if (item->data(0, ReqifParser::SpecificationRole).isNull() || item->childCount() > 0) return;
+    ReqifParser *document = m_workspace.documentForItem(item);
+    if (!document) return;
+
+    QElapsedTimer timer;
+    timer.start();
+    const int countBefore = document->getAllReqCount();
+    if (!document->fillSpecificationItem(item)) {
+        statusBar()->showMessage(QString(u8"规格加载失败：%1").arg(document->errorString()), 5000);
+        return;
+    }
+    m_treeWidget->resizeColumnToContents(0);
+    m_treeWidget->resizeColumnToContents(1);
+    updateMemoryStatus();
+    statusBar()->showMessage(QString(u8"已加载规格 %1：新增 %2 条需求，耗时 %3 毫秒")
+                             .arg(item->text(1)).arg(document->getAllReqCount() - countBefore)
+                             .arg(timer.elapsed()), 5000);
+}
+
+// 设置内存预算（MB，全部文档合计）：超出时描述改为按需从源文件读取，重新加载后生效
+void MainWindow::onSetMemoryBudget() {
+    bool ok = false;
+    const int megabytes = QInputDialog::getInt(this, u8"内存预算",
+                                               u8"全部文档的内存预算（MB，0为不限）：\n"
+                                               u8"超出时描述不再常驻内存，查看时从源文件读取",
+                                               int(m_workspace.memoryBudget() / (1024 * 1024)),
+                                               0, 1024 * 1024, 64, &ok);
+    if (!ok) return;
+    m_workspace.setMemoryBudget(qint64(megabytes) * 1024 * 1024);
+    reopenAll();
+}
+
+// 刷新状态栏中的内存占用：合计显示在状态栏，分类明细作为提示
+void MainWindow::updateMemoryStatus() {
+    if (m_workspace.documents().isEmpty()) {
+        m_memoryLabel->clear();
+        m_memoryLabel->setToolTip(QString());
+        return;
+    }
+
+    int treeItems = 0;
+    for (QTreeWidgetItemIterator it(m_treeWidget); *it; ++it) {
+        ++treeItems;
+    }
+    ReqMemoryUsage usage = m_workspace.memoryUsage();
+    usage.treeItems = ReqMemoryUsage::treeItemBytes(treeItems);
+
+    auto mb = [](qint64 bytes) { return QString::number(double(bytes) / (1024 * 1024), 'f', 1); };
+    QString text = QString(u8"内存约 %1 MB").arg(mb(usage.total()));
+    if (m_workspace.memoryBudget() > 0) {
+        text += QString(u8" / 预算 %1 MB").arg(mb(m_workspace.memoryBudget()));
+    }
+    if (m_workspace.offloadedCount() > 0) {
+        text += QString(u8"（%1 个文档描述按需读取）").arg(m_workspace.offloadedCount());
+    }
+    m_memoryLabel->setText(text);
+    m_memoryLabel->setToolTip(QString(u8"需求记录：%1 MB\nID：%2 MB\n名称：%3 MB\n描述：%4 MB\n"
+                                      u8"层次索引：%5 MB\n检索索引：%6 MB\n需求树（%7 个节点）：%8 MB")
+                              .arg(mb(usage.records), mb(usage.ids), mb(usage.names), mb(usage.descriptions),
+                                   mb(usage.hierarchy), mb(usage.textIndex))
+                              .arg(treeItems).arg(mb(usage.treeItems)));
+}
+
+void MainWindow::onReloadFailed(ReqifParser *document, const QString &error) {
+    statusBar()->showMessage(QString(u8"%1 已变化但重新加载失败，继续显示旧数据：%2")
+                             .arg(QFileInfo(document->filePath()).fileName(), error), 5000);
+}
+
+void MainWindow::onTreeContextMenu(const QPoint &pos) {
+    QTreeWidgetItem *item = m_treeWidget->itemAt(pos);
+    if (!item || item->data(0, Qt::UserRole).toString().isEmpty()) return;
+    if (!item->isSelected()) {
+        m_treeWidget->setCurrentItem(item);
+    }
+
+    QMenu menu(this);
+    QAction *exportAction = menu.addAction(u8"导出子树为ReqIF...");
+    connect(exportAction, &QAction::triggered, this, &MainWindow::onExportSubtree);
+    menu.exec(m_treeWidget->viewport()->mapToGlobal(pos));
+}
+
+void MainWindow::onExportSubtree() {
+    // 子树导出基于单个源文件，只取与当前节点同一文档的选中需求
+    ReqifParser *document = m_workspace.documentForItem(m_treeWidget->currentItem());
+    if (!document) return;
+    QStringList rootIds;
+    foreach (QTreeWidgetItem *item, m_treeWidget->selectedItems()) {
+        const QString reqId = item->data(0, Qt::UserRole).toString();
+        if (!reqId.isEmpty() && m_workspace.documentForItem(item) == document) rootIds.append(reqId);
+    }
+    if (rootIds.isEmpty()) return;
+
+    QString filePath = QFileDialog::getSaveFileName(
+        this, u8"导出子树", "",
+        u8"ReqIF文件 (*.reqif)"
+    );
+    if (filePath.isEmpty()) return;
+
+    QElapsedTimer timer;
+    timer.start();
+    ReqifSubsetExporter exporter(*document);
+    if (exporter.exportSubtrees(rootIds, filePath)) {
+        statusBar()->showMessage(QString(u8"已导出 %1 条需求，耗时 %2 毫秒")
+                                 .arg(exporter.exportedCount()).arg(timer.elapsed()), 5000);
+    } else {
+        QMessageBox::critical(this, u8"导出失败", exporter.errorString());
+    }
 }
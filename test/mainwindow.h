@@ -4,7 +4,10 @@
 #include <QMainWindow>
 #include <QTreeWidget>
 #include <QTextBrowser>
-#include "ReqifParser.h"
+#include <QLabel>
+#include "ReqWorkspace.h"
+
+class ReqRenderCache;
 
 namespace Ui {
 class MainWindow;
@@ -19,18 +22,43 @@ public:
     ~MainWindow();
 
 private slots:
-    void onLoadFile();                       // 加载文件
+    void onLoadFile();                       // 加载文件（可多选，加入工作区）
+    void onCloseAll();                       // 关闭全部文件
+    void onFindReqById();                    // 按ID跨文件查找需求
+    void onExportRecords();                  // 导出需求数据（NDJSON/CSV/JSON）
     void onReqItemClicked(QTreeWidgetItem *item, int column); // 点击需求项
     void onShowTechnicalRequirements();      // 显示技术要求
+    void onReqsChanged(ReqifParser *document, const ReqChangeSet &changes); // 文件变化后局部更新需求树
+    void onReloadFailed(ReqifParser *document, const QString &error);       // 自动重新加载失败
+    void onTreeContextMenu(const QPoint &pos);       // 需求树右键菜单
+    void onExportSubtree();                          // 导出选中子树为ReqIF
+    void onToggleRichText(bool enabled);             // 切换富文本描述
+    void onToggleLazyLoading(bool enabled);          // 切换按规格延迟加载
+    void onToggleOutOfCore(bool enabled);            // 切换超大文件模式（磁盘索引）
+    void onTreeItemExpanded(QTreeWidgetItem *item);  // 展开未加载的规格或索引节点时加载
+    void onSetMemoryBudget();                        // 设置内存预算
 
 private:
     void initUI();                           // 初始化界面
+    ReqifParser *currentDocument() const;    // 当前节点所属文档（只有一个文档时取该文档）
+    void showDescription(ReqifParser *document, const QString &reqId); // 显示需求描述（经渲染缓存）
+    void releaseShownDocument(bool keep);    // 取下当前显示的文档（keep时归还缓存）
+    void reopenAll();                        // 按当前设置重新加载全部文件（保持显示的需求）
+    void prefetchNeighbors(const QString &reqId); // 预渲染相邻及子需求
+    void updateMemoryStatus();               // 刷新状态栏中的内存占用
+    void showDiagnostics();                  // 完整性问题汇总（列出前若干条，可保存完整报告）
+    bool saveDiagnosticReport(const QString &filePath) const; // 保存全部文档的完整性问题
 
 private:
     Ui::MainWindow *ui;
     QTreeWidget *m_treeWidget;               // 需求树
     QTextBrowser *m_descBrowser;             // 描述浏览器
-    ReqifParser m_parser;                    // 解析器
+    QLabel *m_memoryLabel;                   // 状态栏内存占用（悬停显示分类明细）
+    ReqWorkspace m_workspace;                // 已加载的文档
+    ReqRenderCache *m_renderCache;           // 描述渲染缓存（对应当前显示的文档）
+    QString m_shownReqId;                    // 当前显示的需求ID
+    QTextDocument *m_shownDoc = nullptr;     // 当前显示的文档（从缓存取出，由本窗口持有）
+    QString m_filterText;                    // 需求树的过滤关键词（为空时显示完整树）
 };
 
 #endif // MAINWINDOW_H
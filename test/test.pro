@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui widgets xml
+QT       += core gui widgets xml network concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -24,14 +24,44 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 CONFIG += c++11
 
+# 基准构建（qmake CONFIG+=bench）：替换全局分配函数，供 --bench 统计堆分配次数
+bench: DEFINES += REQ_COUNT_ALLOCATIONS
+
 SOURCES += \
         ReqifParser.cpp \
+        ReqTextSearch.cpp \
+        ReqQueryServer.cpp \
+        ReqQueryClient.cpp \
+        ReqifRawFile.cpp \
+        ReqifSubsetExporter.cpp \
+        ReqRecordWriter.cpp \
+        ReqObjectStore.cpp \
+        ReqRenderCache.cpp \
+        ReqStringPool.cpp \
+        ReqWorkspace.cpp \
+        ReqHierarchyInference.cpp \
+        ReqAllocCounter.cpp \
+        ReqDiskIndex.cpp \
         #TEDEmandModelPreview.cpp \
         main.cpp \
         mainwindow.cpp
 
 HEADERS += \
         ReqifParser.h \
+        ReqTextSearch.h \
+        ReqQueryProtocol.h \
+        ReqQueryServer.h \
+        ReqQueryClient.h \
+        ReqifRawFile.h \
+        ReqifSubsetExporter.h \
+        ReqRecordWriter.h \
+        ReqObjectStore.h \
+        ReqRenderCache.h \
+        ReqStringPool.h \
+        ReqWorkspace.h \
+        ReqHierarchyInference.h \
+        ReqAllocCounter.h \
+        ReqDiskIndex.h \
         #TEDEmandModelPreview.h \
         mainwindow.h
 